@@ -0,0 +1,76 @@
+#include "qs.c"
+#include <stdio.h>
+#include <stdlib.h>
+
+// benchmark of the factorization on semiprimes drawn with a fixed seed, one JSON line per number.
+// the optional arguments are the numbers drawn by size and shape (3) and the seed, the exit status is 1 when a number isn't factored.
+// with the argument "tune" it prints the parameter table of the sieve fitted to the host instead, as rows of qs.c.
+
+static const int bench_bits[] = {40, 64, 80, 100, 115, 127};
+
+// a random prime of the given bits whose two highest bits are set, so that the product of two has the sum of their bits.
+static positive_number bench_prime(uint64_t *rng, const int bits) {
+    positive_number p = (positive_number) rng_next(rng) << 64 | rng_next(rng);
+    p = (p >> (128 - bits)) | (positive_number) 3 << (bits - 2) | 1;
+    for (; !is_prime(p); p += 2);
+    return p;
+}
+
+static void bench_print(const char *key, const positive_number n) {
+    char s[40], *p = s + sizeof(s);
+    positive_number m = n;
+    for (*--p = 0; *--p = (char) ('0' + m % 10), m /= 10;);
+    printf("\"%s\":\"%s\",", key, p);
+}
+
+int main(int argc, char **argv) {
+    const int tune = argc > 1 && !strcmp(argv[1], "tune");
+    const unsigned count = argc > 1 ? (unsigned) strtoul(argv[1], 0, 10) : 3;
+    uint64_t rng = argc > 2 ? strtoull(argv[2], 0, 10) : 0x5eed;
+    static const char *const stages[STAGES] = {"primality", "rho", "ecm", "sieve", "matrix", "sqrt"};
+    void *memory = malloc(FACTOR_MEMORY);
+    positive_number n, r, factors[FACTOR_MAX], *f;
+    factor_context_t ctx;
+    factor_stats_t stats;
+    size_t i, j, k, s;
+    int bits, small, ok, failed = 0;
+    double t;
+    if (!memory) return 1;
+    if (tune) {
+        qs_autotune(memory);
+        for (i = 0; i < sizeof(qs_params) / sizeof(*qs_params); ++i)
+            printf("    {%d, %u, %u, %u, %d, %u},\n", qs_params[i].bits, qs_params[i].bound, qs_params[i].block, qs_params[i].blocks, qs_params[i].threshold, qs_params[i].extra);
+        free(memory);
+        return 0;
+    }
+    for (i = 0; i < sizeof(bench_bits) / sizeof(*bench_bits); ++i)
+        for (k = 0; k < 2; ++k)
+            for (j = 0; j < count; ++j) {
+                bits = bench_bits[i], small = k ? bits / 4 : bits / 2; // unbalanced numbers have a factor of a quarter of their bits.
+                n = bench_prime(&rng, small) * bench_prime(&rng, bits - small);
+                memset(&stats, 0, sizeof(stats));
+                factor_context_init(&ctx, memory, 0, (uint64_t) (n ^ n >> 64));
+                ctx.stats = &stats;
+                t = wall_time();
+                f = factor_all(&ctx, n, factors);
+                t = wall_time() - t;
+                for (ok = 1, r = 1, f = factors; *f; r *= *f, ok &= is_prime(*f++));
+                ok = ok && f - factors == 2 && r == n;
+                failed |= !ok;
+                printf("{\"bits\":%d,\"shape\":\"%s\",", bits, k ? "unbalanced" : "balanced");
+                bench_print("n", n);
+                bench_print("p", factors[0]);
+                printf("\"seconds\":%.6f,", t);
+                for (s = 0; s < STAGES; ++s)
+                    printf("\"%s_seconds\":%.6f,", stages[s], stats.seconds[s]);
+                printf("\"primality_tests\":%zu,\"rho_iterations\":%zu,\"squfof_iterations\":%zu,\"ecm_curves\":%zu,", stats.primality, stats.rho, stats.squfof, stats.curves);
+                printf("\"sieves\":%zu,\"factor_base\":%zu,\"blocks\":%zu,\"candidates\":%zu,", stats.sieves, stats.base, stats.counts.blocks, stats.counts.candidates);
+                printf("\"fulls\":%zu,\"partials\":%zu,\"cycles\":%zu,", stats.counts.fulls, stats.counts.partials, stats.counts.cycles);
+                printf("\"rows\":%zu,\"core_rows\":%zu,\"core_columns\":%zu,", stats.rows, stats.core[0], stats.core[1]);
+                printf("\"dependencies\":%zu,\"memory\":%zu,", stats.dependencies, stats.memory);
+                printf("\"ok\":%s}\n", ok ? "true" : "false");
+                fflush(stdout);
+            }
+    free(memory);
+    return failed; // a wrong factorization fails the benchmark target.
+}
@@ -2,34 +2,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <assert.h>
+
+#define STREAM_BATCH 64 // numbers per thread read ahead at most while the previous ones are factored.
 
 // fill the given array with prime factors of n, result will be zero terminated (convenience function).
 positive_number * exec(positive_number n, void * memory, positive_number *array) {
-    positive_number a, b; size_t s ;
-    do  if (n < 4)
-            *array++ = n, n = 1;
-        else if (n & 1) {
-            for (b = n >> 1, a = (b + n / b) >> 1; a < b; b = a, a = (b + n / b) >> 1);
-            if (b * b == n) {
-                s = exec(b, memory, array) - array ;
-                memcpy(array + s, array, s * sizeof(positive_number)) ;
-                array += s + s ;
-                n = 1;
-            } else {
-                if (is_prime(n, 48)) // number of Miller-Rabin tests.
-                    *array++ = n, n = 1;
-                else {
-                    a = factor(n, memory); // call the factor function.
-                    if (a == 1 || a == n) *array++ = n, n = 1;      // fail.
-                    else array = exec(a, memory, array), n /= a;    // success.
-                }
-            }
-        } else
-            for (; !(n & 1); *array++ = 2, n >>= 1);
-    while (n > 1);
-    *array = 0 ;
-    return array ;
+    factor_context_t ctx;
+    factor_context_init(&ctx, memory, 0, (uint64_t) (n ^ n >> 64));
+    return factor_all(&ctx, n, array);
 }
 
 // provided for convenience, take a string and return a 128-bit unsigned integer.
@@ -39,9 +19,8 @@ __uint128_t from_string_128_bits(const char *str) {
     return res;
 }
 
-// provided to print 128-bit unsigned integers.
-static char *to_string_128_bits(__uint128_t num) {
-    static char s[40];
+// provided to print 128-bit unsigned integers into s, which holds 40 chars.
+static char *to_string_128_bits(__uint128_t num, char *s) {
     __uint128_t mask = -1;
     size_t a, b, c = 1, d;
     strcpy(s, "0");
@@ -56,33 +35,120 @@ static char *to_string_128_bits(__uint128_t num) {
     return s;
 }
 
-int main(void){
-    // allocate memory for the factorizer.
-    void * memory = malloc(1 << 25);
-    // allocate memory to store 128 factors.
-    positive_number * factors = calloc(128, sizeof(positive_number)), n = 0, mask = -1;
-    unsigned sr = (size_t)factors; sr = -sr / 1105; printf("srand at %u :\n\n", sr); srand(sr);
-    for (int wrapper = 16, count = 0; wrapper < 120; ++wrapper)
-        for (int n_bits = wrapper, j; n_bits <= 125; ++n_bits) {
-            // generate a random number of ~ n_bits bits.
-            for (size_t k = 0; k < sizeof(positive_number); ((char *) &n)[k++] = rand());
-            n &= mask >> (8 * sizeof(positive_number) - n_bits); n += !(n & 1);
-            printf("%5d. (%3d bits) %40s = ", ++count, n_bits, to_string_128_bits(n));
-            fflush(stdout);
-            // fill the "factors" array with the prime factors.
-            exec(n, memory, factors);
-            // iterate over the factors (zero terminated array).
-            for (j = 0; factors[j + 1]; ++j) {
-                printf("%s * ", to_string_128_bits(factors[j]));
-                assert(n % factors[j] == 0);
-                assert(is_prime(factors[j], 72));
-            }
-            printf("%s\n", to_string_128_bits(factors[j]));
+// next number of the standard input, one per line, lines without a number are skipped. returns 0 at the end of the input.
+static int read_number(positive_number *n) {
+    char line[256], *digits;
+    while (fgets(line, sizeof(line), stdin)) {
+        digits = line + strspn(line, " \t");
+        digits[strspn(digits, "0123456789")] = 0;
+        if (*digits) return *n = from_string_128_bits(digits), 1;
+    }
+    return 0;
+}
+
+// write "n = p * q * ..." from the zero terminated factors of n.
+static void print_factors(const positive_number n, const positive_number *factors) {
+    char text[40];
+    size_t j;
+    printf("%s = ", to_string_128_bits(n, text));
+    for (j = 0; factors[j + 1]; ++j)
+        printf("%s * ", to_string_128_bits(factors[j], text));
+    printf("%s\n", to_string_128_bits(factors[j], text));
+    fflush(stdout);
+}
+
+#ifndef QS_NO_THREADS
+// the lines read ahead wait in a ring, a pool of threads takes them as soon as each one is free.
+typedef struct {
+    positive_number *numbers; // ring of the lines read and not yet taken.
+    size_t head, count, size;
+    int end;                  // the input is over.
+    pthread_mutex_t lock;
+    pthread_cond_t changed;   // signaled when a line is read or taken, and at the end of the input.
+    pthread_mutex_t output;   // held to print a factorization.
+} input_t;
+
+typedef struct {
+    input_t *in;
+    void *memory; // arena of the thread, FACTOR_MEMORY bytes.
+} stream_worker_t;
+
+// factor the next line until the input is over, a number left to the sieve holds up no other thread.
+static void *stream_worker(void *arg) {
+    stream_worker_t *w = arg;
+    input_t *in = w->in;
+    positive_number n, factors[FACTOR_MAX];
+    int more;
+    do {
+        pthread_mutex_lock(&in->lock);
+        while (!in->count && !in->end) pthread_cond_wait(&in->changed, &in->lock);
+        if ((more = in->count != 0)) {
+            n = in->numbers[in->head], in->head = (in->head + 1) % in->size, --in->count;
+            pthread_cond_broadcast(&in->changed);
+        }
+        pthread_mutex_unlock(&in->lock);
+        if (more) {
+            exec(n, w->memory, factors);
+            pthread_mutex_lock(&in->output);
+            print_factors(n, factors);
+            pthread_mutex_unlock(&in->output);
         }
+    } while (more);
+    return 0;
+}
+#endif
+
+// read numbers from the standard input, one per line, and write their factorizations as they complete.
+// the optional argument is a number of threads, with more than one the lines are read while the previous ones are factored.
+int main(int argc, char **argv) {
+    const unsigned threads = argc > 1 ? (unsigned) strtoul(argv[1], 0, 10) : 1;
+    positive_number n, factors[FACTOR_MAX];
+    void *memory;
+    int res = 0;
+#ifndef QS_NO_THREADS
+    if (threads > 1) {
+        const size_t size = (size_t) threads * STREAM_BATCH;
+        input_t in = {malloc(size * sizeof(positive_number)), 0, 0, size, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_MUTEX_INITIALIZER};
+        stream_worker_t *worker = calloc(threads, sizeof(stream_worker_t));
+        pthread_t *thread = malloc(threads * sizeof(pthread_t));
+        unsigned t = 0;
+        // the pool keeps the threads whose arena fits.
+        for (; in.numbers && worker && thread && t < threads && (worker[t].memory = malloc(FACTOR_MEMORY)); ++t) {
+            worker[t].in = &in;
+            if (pthread_create(thread + t, 0, stream_worker, worker + t)) break;
+        }
+        if (t == 0) {
+            fprintf(stderr, "qs: out of memory\n");
+            res = 1;
+        }
+        while (t && read_number(&n)) {
+            pthread_mutex_lock(&in.lock);
+            while (in.count == in.size) pthread_cond_wait(&in.changed, &in.lock);
+            in.numbers[(in.head + in.count++) % in.size] = n;
+            pthread_cond_broadcast(&in.changed);
+            pthread_mutex_unlock(&in.lock);
+        }
+        pthread_mutex_lock(&in.lock);
+        in.end = 1;
+        pthread_cond_broadcast(&in.changed);
+        pthread_mutex_unlock(&in.lock);
+        while (t) pthread_join(thread[--t], 0);
+        for (t = 0; worker && t < threads; free(worker[t++].memory));
+        free(thread), free(worker), free(in.numbers);
+        return res;
+    }
+#else
+    (void) threads; // a single thread reads and factors.
+#endif
+    if (!(memory = malloc(FACTOR_MEMORY))) return 1;
+    while (read_number(&n)) {
+        exec(n, memory, factors);
+        print_factors(n, factors);
+    }
     // release memory.
-    free(factors);
     free(memory);
+    return res;
 }
 
 // You can put it into a primes.c file then compile + execute :
-// gcc -O3 -std=c99 -Wall -pedantic primes.c ; ./a.out ;
+// echo 108291528056611062333982283963 | (gcc -O3 -std=c99 -Wall -pedantic primes.c -lm -pthread ; ./a.out) ;
@@ -5,166 +5,375 @@
 #include <string.h>
 #include <stdint.h>
 #include <math.h>
-
-#define CINT_SCALE (1 << 12)
+#include <sys/time.h>
+#include <unistd.h>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define QS_XOR_DISPATCH // the wide XORs are compiled for their own instruction sets and chosen at run time.
+#endif
+#ifndef QS_NO_THREADS
+#include <pthread.h>
+#endif
 
 typedef __uint128_t positive_number ;
 
 typedef struct {
-    positive_number values [2];
-    char * factors_vect;
+    positive_number X;          // |X^2 - N| is the product of the factor base primes of the relation and of its large primes.
+    uint32_t large[2];          // large primes of a partial relation, 1 when absent.
+    uint32_t index, count;      // factor base indexes dividing |X^2 - N|, with repetition, in the relation pool.
 } smooth_number_t;
 
-static const size_t cint_exponent = 31;
-static const long long int cint_base = 1LL << cint_exponent;
+// relation counts of a quadratic sieve run.
+typedef struct {
+    size_t fulls, partials, cycles; // smooth over the base, with one or two large primes, independent cycles among the partials.
+    size_t blocks, candidates;      // sieved blocks, offsets over the threshold that were divided by the base.
+} qs_counts_t;
+
+#define STAGE_PRIMALITY 0
+#define STAGE_RHO 1
+#define STAGE_ECM 2
+#define STAGE_SIEVE 3  // factor base and relation collection.
+#define STAGE_MATRIX 4 // cycles and elimination.
+#define STAGE_SQRT 5   // square roots of the dependencies.
+#define STAGES 6
 
+// measures of the factorizations, summed over the calls that are given the same struct, except base, rows and core that
+// describe the last sieve and memory that keeps the maximum.
 typedef struct {
-    long long int data[CINT_SCALE];
-    size_t index;
-} cint;
+    double seconds[STAGES];                  // wall time of each stage.
+    size_t primality, rho, squfof, curves;   // primality tests, rho and SQUFOF iterations, elliptic curves.
+    size_t sieves, base, rows, dependencies; // quadratic sieve runs, factor base primes, matrix rows, dependencies tried.
+    size_t core[2];                          // rows and columns left to the dense elimination by the filter.
+    size_t memory;                           // bytes of the largest use of the memory block.
+    qs_counts_t counts;
+} factor_stats_t;
 
-void cint_down2i(cint *number) {
-    if (number->index == CINT_SCALE) return;
-    number->data[CINT_SCALE - 1] >>= 1;
-    for (size_t i = CINT_SCALE - 2; i >= number->index; --i) {
-        number->data[i + 1] |= (number->data[i] & 1) << (cint_exponent - 1);
-        number->data[i] >>= 1;
-    }
-    if (number->data[number->index] == 0) ++number->index;
+static inline double wall_time(void) {
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (double) tv.tv_sec + (double) tv.tv_usec * 1e-6;
 }
 
-void cint_up2i(cint *number) {
-    if (number->index == CINT_SCALE) return;
-    for (size_t i = number->index; i < CINT_SCALE; ++i) {
-        number->data[i - 1] |= number->data[i] >> (cint_exponent - 1);
-        number->data[i] = (number->data[i] << 1) & ~cint_base;
-    }
-    if (number->data[number->index - 1]) --number->index;
+static inline int bit_length(const positive_number x) {
+    return x >> 64 ? 128 - __builtin_clzll((uint64_t) (x >> 64)) : x ? 64 - __builtin_clzll((uint64_t) x) : 0;
 }
 
-static inline void cint_init(cint *num, positive_number value) {
-    memset(num, 0, sizeof(cint));
-    for (num->index = CINT_SCALE; value; num->data[--num->index] = (long long int)(value % cint_base), value /= cint_base);
+// modular arithmetic in Montgomery form, R = 2^64 when the modulus fits a single word, else R = 2^128.
+typedef struct {
+    positive_number n, ni, one, r2; // odd modulus, 1/n mod R, R mod n, R^2 mod n.
+    int wide;                       // the modulus needs two words.
+} montgomery_t;
+
+// 64x64->128 hardware multiplies giving the full 256-bit product, the low half is returned.
+static inline positive_number mul_wide(const positive_number a, const positive_number b, positive_number *hi) {
+    const uint64_t a0 = (uint64_t) a, a1 = (uint64_t) (a >> 64), b0 = (uint64_t) b, b1 = (uint64_t) (b >> 64);
+    const positive_number p00 = (positive_number) a0 * b0, p01 = (positive_number) a0 * b1, p10 = (positive_number) a1 * b0;
+    const positive_number mid = (p00 >> 64) + (uint64_t) p01 + (uint64_t) p10;
+    *hi = (positive_number) a1 * b1 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+    return mid << 64 | (uint64_t) p00;
 }
 
-int cint_compare(const cint *lhs, const cint *rhs) {
-    int res = (int) (rhs->index - lhs->index);
-    if (res == 0 && lhs->index != CINT_SCALE)
-        for (size_t i = rhs->index; !(res = (int) (lhs->data[i] - rhs->data[i])) && ++i < CINT_SCALE;);
-    return res;
+// Montgomery product a * b / R mod n of two reduced operands.
+static inline positive_number mont_mul(const montgomery_t *m, const positive_number a, const positive_number b) {
+    positive_number lo, hi, u, v;
+    if (m->wide) {
+        lo = mul_wide(a, b, &hi);
+        mul_wide(lo * m->ni, m->n, &u);
+        return hi < u ? hi - u + m->n : hi - u;
+    } else {
+        const uint64_t n = (uint64_t) m->n;
+        lo = (positive_number) (uint64_t) a * (uint64_t) b;
+        v = (positive_number) ((uint64_t) lo * (uint64_t) m->ni) * n;
+        hi = lo >> 64, u = v >> 64;
+        return hi < u ? hi - u + n : hi - u;
+    }
 }
 
-void cint_mul(const cint *lhs, const cint *rhs, cint *res) {
-    memset(res, 0, sizeof(cint));
-    if (lhs->index == CINT_SCALE || rhs->index == CINT_SCALE)
-        res->index = CINT_SCALE;
-    else {
-        res->index = 1 + lhs->index + rhs->index - CINT_SCALE;
-        size_t i, j, k = res->index, l;
-        for (i = rhs->index; i < CINT_SCALE; ++i, ++k) {
-            for (l = k, j = lhs->index; j < CINT_SCALE; ++l, ++j)
-                res->data[l] += lhs->data[j] * rhs->data[i];
-            for (j = CINT_SCALE; --j >= res->index;) {
-                res->data[j - 1] += res->data[j] / cint_base;
-                res->data[j] %= cint_base;
-            }
-        }
-        res->index -= res->data[res->index - 1] != 0;
-    }
-}
-
-void cint_subi(cint *lhs, const cint *rhs) {
-    if (lhs->index < CINT_SCALE && rhs->index < CINT_SCALE) {
-        if (lhs->index < rhs->index || lhs->data[lhs->index] >= rhs->data[rhs->index]) {
-            long long int a = 0;
-            size_t i = CINT_SCALE;
-            for (; --i >= rhs->index;)
-                (a = (lhs->data[i] -= rhs->data[i] + a) < 0) ? (lhs->data[i] += cint_base) : 0;
-            for (; a; lhs->data[i] -= a, (a = lhs->data[i] < 0) ? lhs->data[i] += cint_base : 0, --i);
-            for (; lhs->index < CINT_SCALE && !lhs->data[lhs->index]; ++lhs->index);
-        } else cint_init(lhs, 0);
-    }
-}
-
-void cint_addi(cint *lhs, const cint *rhs) {
-    long long int a = 0;
-    size_t i = CINT_SCALE;
-    for (; --i >= rhs->index;)
-        (a = (lhs->data[i] += rhs->data[i] + a) > cint_base - 1) ? (lhs->data[i] -= cint_base) : 0;
-    for (; a; lhs->data[i] += a, (a = lhs->data[i] > cint_base - 1) ? lhs->data[i] -= cint_base : 0, --i);
-    if (1 + i < lhs->index) lhs->index = 1 + i;
-}
-
-void cint_div(const cint *lhs, const cint *rhs, cint *q, cint *r) {
-    cint_init(r, 0);
-    long long int a = cint_compare(lhs, rhs);
-    cint_init(q, 0);
-    if (a) {
-        if (a > 0) {
-            for (size_t i = lhs->index; i < CINT_SCALE; ++i) {
-                for (a = cint_base; a >>= 1;) {
-                    cint_up2i(r);
-                    r->data[CINT_SCALE - 1] = a & lhs->data[i] ? r->data[CINT_SCALE - 1] | 1 : r->data[CINT_SCALE - 1] & ~1;
-                    r->index -= r->data[r->index - 1] != 0;
-                    if (cint_compare(r, rhs) >= 0) {
-                        cint_subi(r, rhs);
-                        q->data[i] |= a;
-                    }
-                }
-            }
-            q->index = lhs->index + CINT_SCALE - rhs->index - 1 ;
-            q->index += q->data[q->index] == 0;
-        } else *r = *lhs ;
-    } else q->data[q->index = CINT_SCALE - 1] = 1;
+static inline positive_number mont_add(const montgomery_t *m, const positive_number a, const positive_number b) {
+    return a >= m->n - b ? a - (m->n - b) : a + b;
 }
 
-void cint_sqrt(const cint *number, cint *root) {
-    static long long int factor = 0;
-    if (factor == 0) factor = 1 + ((long long int) floor(sqrt((double) cint_base)));
-    if (CINT_SCALE == number->index)
-        cint_init(root, 0);
-    else {
-        cint approx = {0}, r;
-        approx.index = (CINT_SCALE + number->index) >> 1;
-        approx.data[approx.index] = 1 + (long long int) floor(sqrt((double) number->data[number->index]));
-        if (((number->index + CINT_SCALE) & 1) == 0 && (approx.data[approx.index] *= factor) >= cint_base)
-            approx.data[approx.index] = cint_base - 1;
-        cint_div(number, &approx, root, &r);
-        cint_addi(root, &approx);
-        cint_down2i(root);
-        if (root->index != approx.index || approx.index != CINT_SCALE - 1 || approx.data[approx.index] - root->data[root->index] >= 2)
-            for (; cint_compare(root, &approx) < 0; approx = *root, cint_div(number, &approx, root, &r), cint_addi(root, &approx), cint_down2i(root));
+static inline positive_number mont_sub(const montgomery_t *m, const positive_number a, const positive_number b) {
+    return a < b ? a - b + m->n : a - b;
+}
+
+static inline void mont_init(montgomery_t *m, const positive_number n) {
+    int i;
+    m->n = n, m->wide = (n >> 64) != 0;
+    for (m->ni = n, i = 0; i < 7; m->ni *= 2 - n * m->ni, ++i); // Newton doubles the correct bits, from 3.
+    if (m->wide) {
+        m->one = -n % n;
+        for (m->r2 = m->one, i = 0; i < 128; m->r2 = mont_add(m, m->r2, m->r2), ++i);
+    } else {
+        m->ni = (uint64_t) m->ni;
+        m->one = (uint64_t) -(uint64_t) n % (uint64_t) n;
+        m->r2 = m->one * m->one % n;
     }
 }
 
+// conversions between the usual and the Montgomery representations.
+static inline positive_number mont_in(const montgomery_t *m, const positive_number x) {
+    return mont_mul(m, x % m->n, m->r2);
+}
+
+static inline positive_number mont_out(const montgomery_t *m, const positive_number x) {
+    return mont_mul(m, x, 1);
+}
+
+// x ^ exp where x and the result are in Montgomery form.
+static inline positive_number mont_pow(const montgomery_t *m, positive_number x, positive_number exp) {
+    positive_number res = m->one;
+    for (; exp; exp >>= 1, x = mont_mul(m, x, x))
+        if (exp & 1) res = mont_mul(m, res, x);
+    return res;
+}
+
 static positive_number multiplication_modulo(positive_number a, positive_number b, const positive_number mod) {
+    if (mod >> 64 == 0) // single word path.
+        return (positive_number) (uint64_t) (a % mod) * (uint64_t) (b % mod) % (uint64_t) mod;
+    if (mod & 1) {
+        montgomery_t m;
+        mont_init(&m, mod);
+        return mont_mul(&m, mont_in(&m, a), b % mod);
+    }
     positive_number res = 0, tmp; // we avoid overflow in modular multiplication.
     for (b %= mod; a; a & 1 ? b >= mod - res ? res -= mod : 0, res += b : 0, a >>= 1, (tmp = b) >= mod - b ? tmp -= mod : 0, b += tmp);
     return res % mod;
 }
 
-static int is_prime(positive_number n, unsigned k) {
-    positive_number a = 0, b, c, d, e, f, g;
-    int h, i;
-    if ((n == 1) == (n & 1)) return n == 2;
-    if (n < 4669921) // fast constexpr for small primes.
-        return ((n & 1) & ((n < 6) * 42 + 0x208A2882) >> n % 30 && (n < 49 || (n % 7 && n % 11 && n % 13 && n % 17 && n % 19 && n % 23 && n % 29 && (n < 961 || (n % 31 && n % 37 && n % 41 && n % 43 && n % 47 && n % 53 && n % 59 && n % 61 && n % 67 && (n < 5041 || (n % 71 && n % 73 && n % 79 && n % 83 && n % 89 && n % 97 && n % 101 && n % 103 && n % 107 && (n < 11881 || (n % 109 && n % 113 && n % 127 && n % 131 && n % 137 && n % 139 && n % 149 && n % 151 && n % 157 && (n < 26569 || (n % 163 && n % 167 && n % 173 && n % 179 && n % 181 && n % 191 && n % 193 && n % 197 && n % 199 && (n < 44521 || (n % 211 && n % 223 && n % 227 && n % 229 && n % 233 && n % 239 && n % 241 && n % 251 && n % 257 && (n < 69169 || (n % 263 && n % 269 && n % 271 && n % 277 && n % 281 && n % 283 && n % 293 && n % 307 && n % 311 && (n < 97969 || (n % 313 && n % 317 && n % 331 && n % 337 && n % 347 && n % 349 && n % 353 && n % 359 && n % 367 && (n < 139129 || (n % 373 && n % 379 && n % 383 && n % 389 && n % 397 && n % 401 && n % 409 && n % 419 && n % 421 && (n < 185761 || (n % 431 && n % 433 && n % 439 && n % 443 && n % 449 && n % 457 && n % 461 && n % 463 && n % 467 && (n < 229441 || (n % 479 && n % 487 && n % 491 && n % 499 && n % 503 && n % 509 && n % 521 && n % 523 && n % 541 && (n < 299209 || (n % 547 && n % 557 && n % 563 && n % 569 && n % 571 && n % 577 && n % 587 && n % 593 && n % 599 && (n < 361201 || (n % 601 && n % 607 && n % 613 && n % 617 && n % 619 && n % 631 && n % 641 && n % 643 && n % 647 && (n < 426409 || (n % 653 && n % 659 && n % 661 && n % 673 && n % 677 && n % 683 && n % 691 && n % 701 && n % 709 && (n < 516961 || (n % 719 && n % 727 && n % 733 && n % 739 && n % 743 && n % 751 && n % 757 && n % 761 && n % 769 && (n < 597529 || (n % 773 && n % 787 && n % 797 && n % 809 && n % 811 && n % 821 && n % 823 && n % 827 && n % 829 && (n < 703921 || (n % 839 && n % 853 && n % 857 && n % 859 && n % 863 && n % 877 && n % 881 && n % 883 && n % 887 && (n < 822649 || (n % 907 && n % 911 && n % 919 && n % 929 && n % 937 && n % 941 && n % 947 && n % 953 && n % 967 && (n < 942841 || (n % 971 && n % 977 && n % 983 && n % 991 && n % 997 && n % 1009 && n % 1013 && n % 1019 && n % 1021 && (n < 1062961 || (n % 1031 && n % 1033 && n % 1039 && n % 1049 && n % 1051 && n % 1061 && n % 1063 && n % 1069 && n % 1087 && (n < 1190281 || (n % 1091 && n % 1093 && n % 1097 && n % 1103 && n % 1109 && n % 1117 && n % 1123 && n % 1129 && n % 1151 && (n < 1329409 || (n % 1153 && n % 1163 && n % 1171 && n % 1181 && n % 1187 && n % 1193 && n % 1201 && n % 1213 && n % 1217 && (n < 1495729 || (n % 1223 && n % 1229 && n % 1231 && n % 1237 && n % 1249 && n % 1259 && n % 1277 && n % 1279 && n % 1283 && (n < 1661521 || (n % 1289 && n % 1291 && n % 1297 && n % 1301 && n % 1303 && n % 1307 && n % 1319 && n % 1321 && n % 1327 && (n < 1852321 || (n % 1361 && n % 1367 && n % 1373 && n % 1381 && n % 1399 && n % 1409 && n % 1423 && n % 1427 && n % 1429 && (n < 2053489 || (n % 1433 && n % 1439 && n % 1447 && n % 1451 && n % 1453 && n % 1459 && n % 1471 && n % 1481 && n % 1483 && (n < 2211169 || (n % 1487 && n % 1489 && n % 1493 && n % 1499 && n % 1511 && n % 1523 && n % 1531 && n % 1543 && n % 1549 && (n < 2411809 || (n % 1553 && n % 1559 && n % 1567 && n % 1571 && n % 1579 && n % 1583 && n % 1597 && n % 1601 && n % 1607 && (n < 2588881 || (n % 1609 && n % 1613 && n % 1619 && n % 1621 && n % 1627 && n % 1637 && n % 1657 && n % 1663 && n % 1667 && (n < 2785561 || (n % 1669 && n % 1693 && n % 1697 && n % 1699 && n % 1709 && n % 1721 && n % 1723 && n % 1733 && n % 1741 && (n < 3052009 || (n % 1747 && n % 1753 && n % 1759 && n % 1777 && n % 1783 && n % 1787 && n % 1789 && n % 1801 && n % 1811 && (n < 3323329 || (n % 1823 && n % 1831 && n % 1847 && n % 1861 && n % 1867 && n % 1871 && n % 1873 && n % 1877 && n % 1879 && (n < 3568321 || (n % 1889 && n % 1901 && n % 1907 && n % 1913 && n % 1931 && n % 1933 && n % 1949 && n % 1951 && n % 1973 && (n < 3916441 || (n % 1979 && n % 1987 && n % 1993 && n % 1997 && n % 1999 && n % 2003 && n % 2011 && n % 2017 && n % 2027 && (n < 4116841 || (n % 2029 && n % 2039 && n % 2053 && n % 2063 && n % 2069 && n % 2081 && n % 2083 && n % 2087 && n % 2089 && (n < 4405801 || (n % 2099 && n % 2111 && n % 2113 && n % 2129 && n % 2131 && n % 2137 && n % 2141 && n % 2143 && n % 2153)))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))));
-    for (b = c = n - 1, h = 0; !(b & 1); b >>= 1, ++h);
-    for (; k--;) {
-        for (g = 0; g < sizeof(positive_number); ((char *) &a)[g++] = (char)rand()); // random number
-        do for (d = e = 1 + a % c, f = n; (d %= f) && (f %= d););
-        while (d > 1 && f > 1);
-        for (d = f = 1; f <= b; f <<= 1);
-        for (; f >>= 1; d = multiplication_modulo(d, d, n), f & b && (d = multiplication_modulo(e, d, n)));
-        if (d == 1) continue;
-        for (i = h; i-- && d != c; d = multiplication_modulo(d, d, n));
-        if (d != c) return 0;
+// splitmix64 step, the generators are states held by their callers.
+static inline uint64_t rng_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ z >> 30) * 0xBF58476D1CE4E5B9ULL, z = (z ^ z >> 27) * 0x94D049BB133111EBULL;
+    return z ^ z >> 31;
+}
+
+// odd primes below 256 for the trial division, grouped so that the product of each group fits a word.
+static const uint8_t small_primes[] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103,
+                                       107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211,
+                                       223, 227, 229, 233, 239, 241, 251};
+static const uint8_t small_groups[] = {0, 15, 25, 34, 42, 50, 53};
+static const uint64_t small_products[] = {16294579238595022365ULL, 7145393598349078859ULL, 6408001374760705163ULL,
+                                          690862709424854779ULL, 4312024209383942993ULL, 14457349ULL};
+
+// strong probable prime test to the base a, with n - 1 = b 2^h.
+static int strong_probable_prime(const montgomery_t *m, const positive_number a, const positive_number b, int h) {
+    const positive_number c = m->n - m->one; // -1 in Montgomery form.
+    positive_number d = mont_pow(m, mont_in(m, a), b);
+    if (d == m->one || d == c) return 1;
+    for (; --h > 0 && d != c; d = mont_mul(m, d, d))
+        if (d == m->one) return 0;
+    return d == c;
+}
+
+// Jacobi symbol (a / n) for an odd n.
+static int jacobi(uint64_t a, uint64_t n) {
+    uint64_t t;
+    int res = 1;
+    for (a %= n; a; t = a, a = n % a, n = t) {
+        for (; !(a & 1); a >>= 1)
+            if ((n & 7) == 3 || (n & 7) == 5) res = -res;
+        if ((a & 3) == 3 && (n & 3) == 3) res = -res;
+    }
+    return n == 1 ? res : 0;
+}
+
+// strong Lucas probable prime test with the parameters of Selfridge : P = 1, Q = (1 - D) / 4, D the first of 5, -7, 9, ... with (D / n) = -1.
+static int strong_lucas_probable_prime(const montgomery_t *m) {
+    const positive_number n = m->n;
+    positive_number a, b, d, D, Q, U, V, Qk;
+    uint64_t k;
+    int h, i, j;
+    for (k = 5;; k += 2) {
+        // (D / n) with D = +-k, reciprocity with the odd k turns it into (n mod k / k).
+        j = jacobi((uint64_t) (n % k), k) * ((k & 3) == 3 && (n & 3) == 3 ? -1 : 1);
+        if (k & 2) j *= (n & 3) == 3 ? -1 : 1; // D = -k, times (-1 / n).
+        if (j == -1) break;
+        if (j == 0 && n != k) return 0;
+        if (k == 61) { // no D is found for a square.
+            for (b = n >> 1, a = (b + n / b) >> 1; a < b; b = a, a = (b + n / b) >> 1);
+            if (b * b == n) return 0;
+        }
+    }
+    D = k & 2 ? n - mont_in(m, k) : mont_in(m, k);
+    // Q = (1 - D) / 4, that is (1 + k) / 4 when D = -k and -(k - 1) / 4 when D = k.
+    Q = k & 2 ? mont_in(m, (k + 1) >> 2) : n - mont_in(m, (k - 1) >> 2);
+    for (d = n + 1, h = 0; !(d & 1); d >>= 1, ++h); // n + 1 doesn't overflow, 2^128 - 1 is a multiple of 3.
+    // left to right over the bits of d : U_2k = U_k V_k, V_2k = V_k^2 - 2 Q^k, then U_k+1 = (U_k + V_k) / 2, V_k+1 = (D U_k + V_k) / 2.
+    U = m->one, V = m->one, Qk = Q;
+    for (i = bit_length(d) - 1; i-- > 0;) {
+        U = mont_mul(m, U, V);
+        V = mont_sub(m, mont_mul(m, V, V), mont_add(m, Qk, Qk));
+        Qk = mont_mul(m, Qk, Qk);
+        if (d >> i & 1) {
+            a = mont_add(m, U, V), b = mont_add(m, mont_mul(m, D, U), V);
+            U = (a >> 1) + (a & 1 ? (n >> 1) + 1 : 0), V = (b >> 1) + (b & 1 ? (n >> 1) + 1 : 0);
+            Qk = mont_mul(m, Qk, Q);
+        }
+    }
+    if (U == 0 || V == 0) return 1;
+    for (; --h > 0;) {
+        V = mont_sub(m, mont_mul(m, V, V), mont_add(m, Qk, Qk));
+        if (V == 0) return 1;
+        Qk = mont_mul(m, Qk, Qk);
+    }
+    return 0;
+}
+
+// single word path : the numbers below 2^64, most of the cofactors, are factored without the 128-bit arithmetic.
+// inverses of the small primes modulo 2^64 and the largest quotients, p divides n when n / p computed as n p^-1 is below 2^64 / p.
+static const uint64_t small_inverses[] = {0xAAAAAAAAAAAAAAABULL, 0xCCCCCCCCCCCCCCCDULL, 0x6DB6DB6DB6DB6DB7ULL, 0x2E8BA2E8BA2E8BA3ULL,
+                                          0x4EC4EC4EC4EC4EC5ULL, 0xF0F0F0F0F0F0F0F1ULL, 0x86BCA1AF286BCA1BULL, 0xD37A6F4DE9BD37A7ULL,
+                                          0x34F72C234F72C235ULL, 0xEF7BDEF7BDEF7BDFULL, 0x14C1BACF914C1BADULL, 0x8F9C18F9C18F9C19ULL,
+                                          0x82FA0BE82FA0BE83ULL, 0x51B3BEA3677D46CFULL, 0x21CFB2B78C13521DULL, 0xCBEEA4E1A08AD8F3ULL,
+                                          0x4FBCDA3AC10C9715ULL, 0xF0B7672A07A44C6BULL, 0x193D4BB7E327A977ULL, 0x7E3F1F8FC7E3F1F9ULL,
+                                          0x9B8B577E613716AFULL, 0xA3784A062B2E43DBULL, 0xF47E8FD1FA3F47E9ULL, 0xA3A0FD5C5F02A3A1ULL,
+                                          0x3A4C0A237C32B16DULL, 0xDAB7EC1DD3431B57ULL, 0x77A04C8F8D28AC43ULL, 0xA6C0964FDA6C0965ULL,
+                                          0x90FDBC090FDBC091ULL, 0x7EFDFBF7EFDFBF7FULL, 0x03E88CB3C9484E2BULL, 0xE21A291C077975B9ULL,
+                                          0x3AEF6CA970586723ULL, 0xDF5B0F768CE2CABDULL, 0x6FE4DFC9BF937F27ULL, 0x5B4FE5E92C0685B5ULL,
+                                          0x1F693A1C451AB30BULL, 0x8D07AA27DB35A717ULL, 0x882383B30D516325ULL, 0xED6866F8D962AE7BULL,
+                                          0x3454DCA410F8ED9DULL, 0x1D7CA632EE936F3FULL, 0x70BF015390948F41ULL, 0xC96BDB9D3D137E0DULL,
+                                          0x2697CC8AEF46C0F7ULL, 0xC0E8F2A76E68575BULL, 0x687763DFDB43BB1FULL, 0x1B10EA929BA144CBULL,
+                                          0x1D10C4C0478BBCEDULL, 0x63FB9AEB1FDCD759ULL, 0x64AFAA4F437B2E0FULL, 0xF010FEF010FEF011ULL,
+                                          0x28CBFBEB9A020A33ULL};
+static const uint64_t small_limits[] = {0x5555555555555555ULL, 0x3333333333333333ULL, 0x2492492492492492ULL, 0x1745D1745D1745D1ULL,
+                                        0x13B13B13B13B13B1ULL, 0x0F0F0F0F0F0F0F0FULL, 0x0D79435E50D79435ULL, 0x0B21642C8590B216ULL,
+                                        0x08D3DCB08D3DCB08ULL, 0x0842108421084210ULL, 0x06EB3E45306EB3E4ULL, 0x063E7063E7063E70ULL,
+                                        0x05F417D05F417D05ULL, 0x0572620AE4C415C9ULL, 0x04D4873ECADE304DULL, 0x0456C797DD49C341ULL,
+                                        0x04325C53EF368EB0ULL, 0x03D226357E16ECE5ULL, 0x039B0AD12073615AULL, 0x0381C0E070381C0EULL,
+                                        0x033D91D2A2067B23ULL, 0x03159721ED7E7534ULL, 0x02E05C0B81702E05ULL, 0x02A3A0FD5C5F02A3ULL,
+                                        0x0288DF0CAC5B3F5DULL, 0x027C45979C95204FULL, 0x02647C69456217ECULL, 0x02593F69B02593F6ULL,
+                                        0x0243F6F0243F6F02ULL, 0x0204081020408102ULL, 0x01F44659E4A42715ULL, 0x01DE5D6E3F8868A4ULL,
+                                        0x01D77B654B82C339ULL, 0x01B7D6C3DDA338B2ULL, 0x01B2036406C80D90ULL, 0x01A16D3F97A4B01AULL,
+                                        0x01920FB49D0E228DULL, 0x01886E5F0ABB0499ULL, 0x017AD2208E0ECC35ULL, 0x016E1F76B4337C6CULL,
+                                        0x016A13CD15372904ULL, 0x01571ED3C506B39AULL, 0x015390948F40FEACULL, 0x014CAB88725AF6E7ULL,
+                                        0x0149539E3B2D066EULL, 0x013698DF3DE07479ULL, 0x0125E22708092F11ULL, 0x0120B470C67C0D88ULL,
+                                        0x011E2EF3B3FB8744ULL, 0x0119453808CA29C0ULL, 0x0112358E75D30336ULL, 0x010FEF010FEF010FULL,
+                                        0x0105197F7D734041ULL};
+
+typedef struct {
+    uint64_t n, ni, one, r2; // odd modulus, 1/n mod 2^64, 2^64 mod n, 2^128 mod n.
+} montgomery64_t;
+
+static inline uint64_t mont64_mul(const montgomery64_t *m, const uint64_t a, const uint64_t b) {
+    const positive_number p = (positive_number) a * b;
+    const uint64_t hi = (uint64_t) (p >> 64), u = (uint64_t) ((positive_number) ((uint64_t) p * m->ni) * m->n >> 64);
+    return hi < u ? hi - u + m->n : hi - u;
+}
+
+static inline uint64_t mont64_add(const montgomery64_t *m, const uint64_t a, const uint64_t b) {
+    return a >= m->n - b ? a - (m->n - b) : a + b;
+}
+
+static inline void mont64_init(montgomery64_t *m, const uint64_t n) {
+    int i;
+    for (m->n = m->ni = n, i = 0; i < 5; m->ni *= 2 - n * m->ni, ++i);
+    m->one = -n % n;
+    m->r2 = (uint64_t) ((positive_number) m->one * m->one % n);
+}
+
+static inline uint64_t mont64_in(const montgomery64_t *m, const uint64_t x) {
+    return mont64_mul(m, x % m->n, m->r2);
+}
+
+static inline uint64_t mont64_pow(const montgomery64_t *m, uint64_t x, uint64_t exp) {
+    uint64_t res = m->one;
+    for (; exp; exp >>= 1, x = mont64_mul(m, x, x))
+        if (exp & 1) res = mont64_mul(m, res, x);
+    return res;
+}
+
+static inline uint64_t square_root_64(const uint64_t x) {
+    uint64_t r = (uint64_t) sqrt((double) x);
+    for (r = r > 0xFFFFFFFF ? 0xFFFFFFFF : r; r * r > x; --r);
+    for (; r < 0xFFFFFFFF && (r + 1) * (r + 1) <= x; ++r);
+    return r;
+}
+
+// floor of the square root, by Newton's method above 2^64.
+static positive_number square_root(const positive_number n) {
+    positive_number a, b;
+    if (!(n >> 64)) return square_root_64((uint64_t) n);
+    for (b = n >> 1, a = (b + n / b) >> 1; a < b; b = a, a = (b + n / b) >> 1);
+    return b;
+}
+
+// r when n = r^k for an odd prime k, else 1. the roots of the odd powers of 128 bits hold in 43 bits.
+static positive_number perfect_power_root(const positive_number n) {
+    static const unsigned char primes[] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79};
+    positive_number p;
+    uint64_t r, s;
+    size_t i, k;
+    for (i = 0; i < sizeof(primes) && bit_length(n) > primes[i]; ++i)
+        for (r = (uint64_t) powl((long double) n, 1.L / primes[i]), s = r ? r - 1 : 0; s <= r + 1; ++s) {
+            for (p = 1, k = 0; s > 1 && k < primes[i] && p <= n / s; p *= s, ++k);
+            if (s > 1 && k == primes[i] && p == n) return s;
+        }
+    return 1;
+}
+
+// smallest odd prime below 256 dividing n, else 1.
+static uint64_t trial_division_64(const uint64_t n) {
+    size_t i;
+    for (i = 0; i < sizeof(small_primes); ++i)
+        if (n * small_inverses[i] <= small_limits[i]) return small_primes[i];
+    return 1;
+}
+
+static int strong_probable_prime_64(const montgomery64_t *m, const uint64_t a, const uint64_t b, int h) {
+    const uint64_t c = m->n - m->one;
+    uint64_t d = mont64_pow(m, mont64_in(m, a), b);
+    if (d == m->one || d == c) return 1;
+    for (; --h > 0 && d != c; d = mont64_mul(m, d, d))
+        if (d == m->one) return 0;
+    return d == c;
+}
+
+// Miller-Rabin with the bases of is_prime, trial division by multiplications with the inverses of the small primes.
+static int is_prime_64(const uint64_t n) {
+    static const uint32_t bases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+    montgomery64_t m;
+    uint64_t b;
+    size_t i;
+    int h;
+    if (n < 3 || !(n & 1)) return n == 2;
+    for (i = 0; i < sizeof(small_primes); ++i) {
+        if (n * small_inverses[i] <= small_limits[i]) return n == small_primes[i];
+        if ((uint64_t) small_primes[i] * small_primes[i] > n) return 1;
     }
+    mont64_init(&m, n);
+    for (b = n - 1, h = 0; !(b & 1); b >>= 1, ++h);
+    for (i = 0; i < sizeof(bases) / sizeof(*bases); ++i)
+        if (bases[i] % n && !strong_probable_prime_64(&m, bases[i] % n, b, h)) return 0;
     return 1;
 }
 
+// deterministic primality : Miller-Rabin with bases proven below 2^64, else trial division by the small primes and Baillie-PSW.
+static int is_prime(const positive_number n) {
+    positive_number b;
+    montgomery_t m;
+    uint64_t r;
+    size_t g, i;
+    int h;
+    if (!(n >> 64)) return is_prime_64((uint64_t) n);
+    if (!(n & 1)) return 0;
+    for (g = 0; g + 1 < sizeof(small_groups); ++g)
+        for (r = (uint64_t) (n % small_products[g]), i = small_groups[g]; i < small_groups[g + 1]; ++i)
+            if (r % small_primes[i] == 0) return 0;
+    mont_init(&m, n);
+    for (b = n - 1, h = 0; !(b & 1); b >>= 1, ++h);
+    return strong_probable_prime(&m, 2, b, h) && strong_lucas_probable_prime(&m);
+}
+
 positive_number mod_pow(positive_number x, positive_number exp, positive_number n) {
     positive_number res = 1;
+    if (n & 1) {
+        montgomery_t m;
+        mont_init(&m, n);
+        return mont_out(&m, mont_pow(&m, mont_in(&m, x), exp));
+    }
     for (x %= n;; exp >>= 1, x = multiplication_modulo(x, x, n))
         if (exp) {
             if (exp & 1) res = multiplication_modulo(res, x, n);
@@ -178,147 +387,1656 @@ static inline void *mem_straight(void *ptr) {
     return res;
 }
 
+#define RHO_BATCH 128 // differences multiplied together before each gcd of the rho method.
+
+static inline int ctz_wide(const positive_number x) {
+    return (uint64_t) x ? __builtin_ctzll((uint64_t) x) : 64 + __builtin_ctzll((uint64_t) (x >> 64));
+}
+
+// binary gcd, shifts and subtractions instead of the 128-bit divisions.
+static positive_number gcd_binary(positive_number a, positive_number b) {
+    positive_number t;
+    int s;
+    if (a == 0 || b == 0) return a | b;
+    s = ctz_wide(a | b), a >>= ctz_wide(a);
+    do {
+        b >>= ctz_wide(b);
+        if (a > b) t = a, a = b, b = t;
+    } while (b -= a);
+    return a << s;
+}
+
+// Brent's rho walking x := x^2 + 1 from the start value d, gives up after about 2 scale steps, counted in *steps when not null.
+// the differences |x - y| are multiplied RHO_BATCH at a time, a product that collapses to n is walked again one gcd per step.
+static positive_number rho_walk(const positive_number n, const size_t scale, positive_number d, size_t *steps) {
+    positive_number x, y, ys, q, g = 1;
+    size_t i, k, r, w = 0;
+    montgomery_t m;
+    if (!(n & 1)) return 2;
+    mont_init(&m, n); // the walk happens in Montgomery form, gcd(x - y, n) is unaffected.
+    y = ys = d % n, q = m.one, x = y;
+    for (r = 1; g == 1; r <<= 1) {
+        if (r >= scale) { // timeout given by the scale argument.
+            if (steps) *steps += w;
+            return n;
+        }
+        for (x = y, i = 0; i < r; ++i)
+            y = mont_add(&m, mont_mul(&m, y, y), m.one);
+        for (w += r, k = 0; k < r && g == 1; k += RHO_BATCH, w += i) {
+            for (ys = y, i = 0; i < RHO_BATCH && k + i < r; ++i) {
+                y = mont_add(&m, mont_mul(&m, y, y), m.one);
+                q = mont_mul(&m, q, x > y ? x - y : y - x);
+            }
+            g = gcd_binary(q, n);
+        }
+    }
+    if (steps) *steps += w;
+    if (g == n) // back to the start of the last batch.
+        do {
+            ys = mont_add(&m, mont_mul(&m, ys, ys), m.one);
+            g = gcd_binary(x > ys ? x - ys : ys - x, n);
+        } while (g == 1);
+    return g;
+}
+
 positive_number factor_rho(const positive_number n, const size_t scale) {
-    size_t a = -1, b = 2 ;
-    positive_number c, d = 1 + rand(), e, f;
-    c = d %= n;
+    uint64_t rng = (uint64_t) (n ^ n >> 64) ^ scale;
+    return rho_walk(n, scale, 1 + rng_next(&rng), 0);
+}
+
+static uint64_t gcd_64(uint64_t a, uint64_t b) {
+    uint64_t t;
+    int s;
+    if (a == 0 || b == 0) return a | b;
+    s = __builtin_ctzll(a | b), a >>= __builtin_ctzll(a);
     do {
-        if (++a == b) {
-            // timeout given by the scale argument.
-            if (a >= scale) return n ;
-            d = c, b <<= 1, a = 0;
+        b >>= __builtin_ctzll(b);
+        if (a > b) t = a, a = b, b = t;
+    } while (b -= a);
+    return a << s;
+}
+
+#define RHO_64_SCALE 3 // the single word rho gives up after about 2^(bits / 4 + RHO_64_SCALE) steps, then comes SQUFOF.
+
+// rho_walk in a single word.
+static uint64_t rho_walk_64(const uint64_t n, const size_t scale, uint64_t d, size_t *steps) {
+    uint64_t x, y, ys, q, g = 1;
+    size_t i, k, r, w = 0;
+    montgomery64_t m;
+    mont64_init(&m, n);
+    y = ys = d % n, q = m.one, x = y;
+    for (r = 1; g == 1; r <<= 1) {
+        if (r >= scale) {
+            if (steps) *steps += w;
+            return n;
+        }
+        for (x = y, i = 0; i < r; ++i)
+            y = mont64_add(&m, mont64_mul(&m, y, y), m.one);
+        for (w += r, k = 0; k < r && g == 1; k += RHO_BATCH, w += i) {
+            for (ys = y, i = 0; i < RHO_BATCH && k + i < r; ++i) {
+                y = mont64_add(&m, mont64_mul(&m, y, y), m.one);
+                q = mont64_mul(&m, q, x > y ? x - y : y - x);
+            }
+            g = gcd_64(q, n);
         }
-        c = multiplication_modulo(c, c, n);
-        for (++c, c *= c != n, e = n, f = c > d ? c - d : d - c; (f %= e) && (e %= f););
-    } while ((f |= e) == 1);
-    return f;
+    }
+    if (steps) *steps += w;
+    if (g == n)
+        do {
+            ys = mont64_add(&m, mont64_mul(&m, ys, ys), m.one);
+            g = gcd_64(x > ys ? x - ys : ys - x, n);
+        } while (g == 1);
+    return g;
 }
 
-positive_number factor(const positive_number number, void *memory) {
-    positive_number a, b, c; // the number 12 is a parameter to the quadratic sieve.
-    size_t d, e = 16, f, g, h, i, j, k, l, m;
-    cint r, s, t, u, v;
-    unsigned long * m_roots, * mr_ptr ;
-    smooth_number_t *x_squared, *smooth_numbers;
-    char *M_1, *M_2, *T, *base_reset_fact;
-    if (number < 4)
-        return number; // number isn't factorisable.
-    for (b = number >> 1, a = (b + number / b) >> 1; a < b; b = a, a = (b + number / b) >> 1, ++e);
-    b = number - a * a;
-    if (b) ++a;
-    else
-        return a ; // number is a perfect square.
-    if (is_prime(number, e))
-        return number; // number is prime.
-    for(f = 10; f <= 18; ++f) {
-        c = factor_rho(number, 1 << f);
-        if (c != number && c != 1)
-            return c ; // number is factored by rho.
-    }
-    // begin quadratic sieve factorization.
-    long double fp = logl((long double) number);
-    d = 1 + (unsigned long) ceill(expl(sqrtl(fp * logl(fp)) / 2));
-    //
-    m = 1 << 12 ; // the number 12 is a parameter to the sieve.
-    d >> 13 || (d = 1 << 13) ; // the number 13 is a parameter to the sieve.
-    //
-    m_roots = mem_straight(memory), mr_ptr = m_roots;
-    for (l = 2; l < d; l += 1 + (l & 1))
-        if (is_prime(l, 20) && mod_pow(number % l, (l - 1) >> 1, l) == 1) {
-            if (number % l) {
-                if (3 == (l & 3))
-                    f = mod_pow(number, (l + 1) >> 2, l);
-                else {
-                    for (f = l - 1, i = 0; !(f & 1); f >>= 1, ++i);
-                    for (g = 2; 1 + mod_pow(g, (l - 1) >> 1, l) != l; ++g);
-                    for (g = mod_pow(g, f, l), f = mod_pow(number, (f + (h = 1)) >> 1, l), k = mod_pow(number, l - 2, l); h;
-                         h ? (f = multiplication_modulo(f, (j = i - h - 1) ? mod_pow(g, 1 << j, l) : g, l)) : 0)
-                        for (h = 0, j = multiplication_modulo(mod_pow(f, 2, l), k, l);
-                             j != 1; ++h, j = mod_pow(j, 2, l));
+// Shanks' square forms factorization of an odd composite n that is not a square, the multipliers are tried in turn.
+// the forms of k n < 2^75 have coefficients below 2^39, returns 1 when all the multipliers fail.
+static uint64_t squfof(const uint64_t n, size_t *steps) {
+    static const uint16_t multipliers[] = {1, 3, 5, 7, 11, 15, 21, 33, 35, 55, 77, 105, 165, 231, 385, 1155};
+    positive_number D;
+    uint64_t P0, P, Pprev, Q, Qprev, q, b, r, i, B, w = 0;
+    size_t k;
+    for (k = 0; k < sizeof(multipliers) / sizeof(*multipliers); ++k) {
+        D = (positive_number) multipliers[k] * n;
+        B = 6 * (uint64_t) sqrt(2 * sqrt((double) D)); // the cycles stop at 3 L, L = 2 sqrt(2 sqrt(k n)) grows with the multiplier.
+        P0 = (uint64_t) sqrtl((long double) D);
+        for (; (positive_number) P0 * P0 > D; --P0);
+        for (; (positive_number) (P0 + 1) * (P0 + 1) <= D; ++P0);
+        Pprev = P = P0, Qprev = 1, Q = (uint64_t) (D - (positive_number) P0 * P0);
+        if (Q == 0) continue;
+        // forward cycle to a square form at an even index, the squares are filtered by their residues modulo 64.
+        for (i = 2; i < B; ++i) {
+            b = (P0 + P) / Q, P = b * Q - P, q = Q;
+            Q = Qprev + b * (Pprev - P);
+            if (!(i & 1) && 0x202021202030213ULL >> (Q & 63) & 1 && (r = square_root_64(Q), r * r == Q)) break;
+            Qprev = q, Pprev = P;
+        }
+        w += i;
+        if (i >= B) continue;
+        // reverse cycle from the square root of the form until P repeats.
+        b = (P0 - P) / r, Pprev = P = b * r + P, Qprev = r;
+        Q = (uint64_t) ((D - (positive_number) Pprev * Pprev) / Qprev);
+        for (i = 0; i < B; ++i) {
+            b = (P0 + P) / Q, Pprev = P, P = b * Q - P, q = Q;
+            Q = Qprev + b * (Pprev - P), Qprev = q;
+            if (P == Pprev) break;
+        }
+        w += i;
+        if (i < B && (r = gcd_64(n, P)) != 1 && r != n) {
+            if (steps) *steps += w;
+            return r;
+        }
+    }
+    if (steps) *steps += w;
+    return 1;
+}
+
+#define ECM_D 210 // giant step of the second stage, the baby steps are the odd j < ECM_D / 2 prime to it.
+
+// point of a Montgomery curve B y^2 = x^3 + A x^2 + x in X:Z coordinates, (A + 2) / 4 is held as a24 = an / ad.
+typedef struct {
+    positive_number X, Z;
+} ecm_point_t;
+
+static inline ecm_point_t ecm_double(const montgomery_t *m, const ecm_point_t P, const positive_number an, const positive_number ad) {
+    const positive_number s = mont_add(m, P.X, P.Z), d = mont_sub(m, P.X, P.Z);
+    const positive_number t1 = mont_mul(m, s, s), t2 = mont_mul(m, d, d), t3 = mont_sub(m, t1, t2), w = mont_mul(m, ad, t2);
+    ecm_point_t R;
+    R.X = mont_mul(m, t1, w), R.Z = mont_mul(m, t3, mont_add(m, w, mont_mul(m, an, t3)));
+    return R;
+}
+
+// P + Q knowing P - Q.
+static inline ecm_point_t ecm_add(const montgomery_t *m, const ecm_point_t P, const ecm_point_t Q, const ecm_point_t D) {
+    const positive_number u = mont_mul(m, mont_sub(m, P.X, P.Z), mont_add(m, Q.X, Q.Z));
+    const positive_number v = mont_mul(m, mont_add(m, P.X, P.Z), mont_sub(m, Q.X, Q.Z));
+    const positive_number s = mont_add(m, u, v), d = mont_sub(m, u, v);
+    ecm_point_t R;
+    R.X = mont_mul(m, D.Z, mont_mul(m, s, s)), R.Z = mont_mul(m, D.X, mont_mul(m, d, d));
+    return R;
+}
+
+// k P with the Montgomery ladder, k > 0.
+static ecm_point_t ecm_multiply(const montgomery_t *m, const ecm_point_t P, const uint64_t k, const positive_number an, const positive_number ad) {
+    ecm_point_t R0 = P, R1 = ecm_double(m, P, an, ad);
+    for (int i = 62 - __builtin_clzll(k); i >= 0; --i)
+        if (k >> i & 1) R0 = ecm_add(m, R1, R0, P), R1 = ecm_double(m, R1, an, ad);
+        else R1 = ecm_add(m, R1, R0, P), R0 = ecm_double(m, R0, an, ad);
+    return R0;
+}
+
+// Lenstra's elliptic curve method on at most "curves" curves of Suyama, stage 1 up to b1 then the standard continuation up to b2.
+// memory holds b2 / 2 bytes for the sieve of the primes, b1 >= 2 ECM_D, returns n when no factor is found.
+// the curves are counted in *tried when not null.
+static positive_number factor_ecm(const positive_number n, const size_t b1, const size_t b2, size_t curves, uint64_t *rng, void *memory, size_t *tried) {
+    unsigned char *composite = memory; // composite[i] tells whether 2 i + 1 is composite.
+    ecm_point_t P, Q, G, T, U, W, baby[ECM_D / 4];
+    positive_number u, v, an, ad, g, acc;
+    size_t i, j, k, q, p;
+    montgomery_t m;
+    mont_init(&m, n);
+    memset(composite, 0, b2 / 2 + 1);
+    for (i = 1; (2 * i + 1) * (2 * i + 1) <= b2; ++i)
+        if (!composite[i])
+            for (j = (2 * i + 1) * (2 * i + 1) / 2; j <= b2 / 2; composite[j] = 1, j += 2 * i + 1);
+    for (g = 1; curves--;) {
+        if (tried) ++*tried;
+        // sigma > 5, u = sigma^2 - 5, v = 4 sigma, x0 = u^3, z0 = v^3, (A + 2) / 4 = (v - u)^3 (3 u + v) / (16 u^3 v).
+        const positive_number sigma = mont_in(&m, 6 + rng_next(rng) % 0xFFFFFFF0u);
+        u = mont_sub(&m, mont_mul(&m, sigma, sigma), mont_in(&m, 5)), v = mont_add(&m, sigma, sigma), v = mont_add(&m, v, v);
+        P.X = mont_mul(&m, mont_mul(&m, u, u), u), P.Z = mont_mul(&m, mont_mul(&m, v, v), v);
+        g = mont_sub(&m, v, u), an = mont_mul(&m, mont_mul(&m, g, g), g);
+        an = mont_mul(&m, an, mont_add(&m, mont_add(&m, mont_add(&m, u, u), u), v));
+        ad = mont_mul(&m, P.X, v), ad = mont_add(&m, ad, ad), ad = mont_add(&m, ad, ad), ad = mont_add(&m, ad, ad), ad = mont_add(&m, ad, ad);
+        // stage 1 : the largest powers of the primes below b1.
+        for (q = 2; q * 2 <= b1; q *= 2);
+        P = ecm_multiply(&m, P, q, an, ad);
+        for (i = 1; 2 * i + 1 <= b1; ++i)
+            if (!composite[i]) {
+                for (p = 2 * i + 1, q = p; q * p <= b1; q *= p);
+                P = ecm_multiply(&m, P, q, an, ad);
+            }
+        g = gcd_binary(P.Z, n);
+        if (g == n) continue; // every factor at once, an other curve may separate them.
+        if (g > 1) return g;
+        // stage 2 : the primes b1 < m D +- j <= b2 meet when X(m D P) Z(j P) - X(j P) Z(m D P) vanishes modulo a factor.
+        Q = ecm_double(&m, P, an, ad);
+        for (W = P, U = P, j = 1, k = 0; j < ECM_D / 2; j += 2) { // U is j P and W is (j - 2) P, the same X:Z as -P at first.
+            if (j % 3 && j % 5 && j % 7) baby[k++] = U;
+            T = ecm_add(&m, U, Q, W), W = U, U = T;
+        }
+        G = ecm_multiply(&m, P, ECM_D, an, ad), q = b1 / ECM_D; // b1 >= 2 ECM_D so that q > 1.
+        T = ecm_multiply(&m, P, q * ECM_D, an, ad), U = ecm_multiply(&m, P, (q - 1) * ECM_D, an, ad);
+        for (acc = m.one; q * ECM_D <= b2 + ECM_D / 2; ++q) {
+            for (i = 0, p = q * ECM_D, j = 1; j < ECM_D / 2; j += 2)
+                if (j % 3 && j % 5 && j % 7) {
+                    if ((p - j > b1 && p - j <= b2 && !composite[(p - j) / 2]) || (p + j > b1 && p + j <= b2 && !composite[(p + j) / 2]))
+                        acc = mont_mul(&m, acc, mont_sub(&m, mont_mul(&m, T.X, baby[i].Z), mont_mul(&m, baby[i].X, T.Z)));
+                    ++i;
+                }
+            W = ecm_add(&m, T, G, U), U = T, T = W;
+        }
+        g = gcd_binary(acc, n);
+        if (g > 1 && g < n) return g;
+    }
+    return n;
+}
+
+#define QS_SKIP 16          // primes below are not sieved, their contribution is part of the threshold tolerance.
+#define QS_RESIEVE (1 << 11) // primes above are found again by resieving the candidates rather than by division.
+#define QS_SIQS 64          // numbers of at least this many bits are sieved with many polynomials.
+#define QS_A_FACTORS 16     // maximal number of primes in the SIQS coefficient A.
+#define QS_A_USED 4096      // the coefficients A already used are remembered, a repeated A would repeat its relations.
+#define QS_A_TRIES 64       // draws of used coefficients A in a row before the primes of A are drawn from a wider range.
+#define QS_RELATIONS (1 << 16) // room for full and partial relations.
+#define QS_FACTORS 64       // maximal number of prime factors (with repetition) of a relation.
+#define QS_BATCH 1024       // relations a sieving thread collects before handing them over.
+#define QS_ROOM 3           // the merged rows of the filter may take this many times the nonzeros of the matrix.
+#define QS_EXCESS 32        // the filter deletes the heaviest rows beyond this excess of rows over columns.
+#define QS_MERGE 4          // the filter eliminates the columns of at most this weight.
+#ifndef QS_LARGE
+#define QS_LARGE 6          // a single large prime is below the largest prime of the base times 2^QS_LARGE.
+#endif
+#ifndef QS_LARGE_2
+#define QS_LARGE_2 0        // a cofactor split in two large primes is below the single bound times the largest prime times 2^QS_LARGE_2.
+#endif
+
+// parameters of the sieve by size of k N, the bound of the base is interpolated between the rows.
+typedef struct {
+    int bits;        // size of k N from which the row applies.
+    uint32_t bound;  // the primes of the base are below.
+    uint32_t block;  // bytes of a sieve block, sized to stay in the L1 data cache.
+    uint32_t blocks; // the self-initializing sieve spans [-M, M) with M = blocks * block.
+    int threshold;   // bits added to the threshold of the sieve, which leaves room for the cofactors kept.
+    uint32_t extra;  // relations collected beyond the size of the base.
+} qs_params_t;
+
+// qs_autotune rewrites the table for the host, the sieves read it.
+static qs_params_t qs_params[] = {
+    {40, 500, 1 << 15, 1, 13, 16},
+    {50, 500, 1 << 15, 1, 13, 16},
+    {60, 900, 1 << 15, 2, 11, 16},
+    {70, 1500, 1 << 15, 2, 13, 16},
+    {80, 3000, 1 << 15, 2, 13, 16},
+    {90, 3000, 1 << 15, 2, 13, 16},
+    {100, 4500, 1 << 15, 2, 11, 16},
+    {110, 7000, 1 << 15, 2, 9, 16},
+    {120, 10000, 1 << 15, 2, 9, 16},
+    {130, 16000, 1 << 15, 2, 9, 16},
+};
+
+typedef struct {
+    uint32_t p, sqrt_n, root[2]; // prime, a square root of k N modulo p, next offsets of both roots in the block.
+    uint32_t first[2], ainv;     // offsets of the roots at the start of the polynomial, 1 / A modulo p.
+    unsigned char log;           // rounded log2(p) added at each hit, 0 for -1 and the primes dividing A.
+} fb_prime_t;
+
+// options of the quadratic sieve, a null pointer stands for a single thread.
+typedef struct {
+    unsigned threads;  // sieving threads, each one with its own arena.
+    int deterministic; // merge the relations in the order of the coefficients A, the result doesn't depend on the threads.
+} qs_config_t;
+
+// state shared by the sieving threads, the base starts with a placeholder for -1 so that column 0 holds the sign.
+typedef struct {
+    positive_number n, *a_used; // n is the number times its multiplier, the sieve calls it N.
+    fb_prime_t *base;
+    size_t d, j, s_from, r_from, m, M, s, a_count, committed; // committed counts the A merged in deterministic mode.
+    size_t a_wide;                    // primes added on each side of the range the primes of A are drawn from.
+    unsigned char threshold, tolerance;
+    // the partial relations are edges between their large primes (vertex 0 stands for 1) of a union-find forest.
+    smooth_number_t *relations;
+    uint16_t *pool;
+    uint32_t (*vertices)[2], *forest; // open addressing table from large primes to vertices, union-find parents.
+    size_t count, pool_used, vertex_count;
+    uint64_t large, large_2;          // bounds on a single large prime and on a cofactor split in two.
+    qs_counts_t counts;
+    uint64_t seed;
+    int deterministic, done;
+#ifndef QS_NO_THREADS
+    pthread_mutex_t lock;             // held to draw an A and to merge a batch.
+    pthread_cond_t turn;              // signaled when an A is merged or when the sieve is done.
+#endif
+} qs_shared_t;
+
+// state of a sieving thread, its relations wait in a batch with a pool of their own.
+typedef struct {
+    qs_shared_t *shared;
+    positive_number A, B_l[QS_A_FACTORS]; // the residues are ((A x + B)^2 - N) / A, B is the sum of +-B_l.
+    __int128_t B;
+    fb_prime_t *base;                     // copy of the base with the roots of the current polynomial.
+    size_t a_index[QS_A_FACTORS], a_number, count, pool_used; // primes and rank of the current A.
+    unsigned char *sieve, threshold;
+    uint32_t *candidates, (*hits)[2], *b_ainv; // b_ainv holds 2 B_l / A modulo p, for each of the s primes of A.
+    smooth_number_t *batch;
+    uint16_t *pool;
+    size_t blocks, scanned;               // counted since the last batch.
+    int done;
+} qs_sieve_t;
+
+#ifndef QS_NO_THREADS
+#define QS_LOCK(shared) pthread_mutex_lock(&(shared)->lock)
+#define QS_UNLOCK(shared) pthread_mutex_unlock(&(shared)->lock)
+#else
+#define QS_LOCK(shared) ((void) 0)
+#define QS_UNLOCK(shared) ((void) 0)
+#endif
+
+static inline uint32_t inverse_mod(uint32_t a, const uint32_t p) {
+    int64_t u = 1, v = 0, t;
+    uint32_t b = p, q;
+    for (; b; q = a / b, t = u - q * v, u = v, v = t, q = a - q * b, a = b, b = q);
+    return (uint32_t) (u < 0 ? u + p : u);
+}
+
+// add the logarithms of the primes from the index "from" at their roots, then leave the roots relative to the next block.
+static void sieve_block(unsigned char *sieve, fb_prime_t *base, size_t from, const size_t d, const uint32_t m) {
+    for (; from < d; ++from) {
+        const uint32_t p = base[from].p;
+        const unsigned char log = base[from].log;
+        uint32_t o = base[from].root[0], q = base[from].root[1], safe = p < m ? m - p : 0;
+        if (log == 0) continue;
+        for (; q < safe && o < safe; sieve[o] += log, sieve[q] += log, o += p, q += p); // both roots together while safe.
+        for (; o < m; sieve[o] += log, o += p);
+        for (; q < m; sieve[q] += log, q += p);
+        base[from].root[0] = o - m, base[from].root[1] = q - m;
+    }
+}
+
+// collect the offsets whose byte crossed the threshold (high bit set), tested 32 bytes at a time.
+static size_t sieve_scan(const unsigned char *sieve, const uint32_t m, uint32_t *candidates, const size_t limit) {
+    uint64_t w[4];
+    size_t n = 0;
+    for (uint32_t i = 0, o; i < m && n < limit; i += 32) {
+        memcpy(w, sieve + i, sizeof(w));
+        if ((w[0] | w[1] | w[2] | w[3]) & 0x8080808080808080ULL)
+            for (o = i; o < i + 32 && n < limit; ++o)
+                if (sieve[o] & 0x80) candidates[n++] = o;
+    }
+    return n;
+}
+
+// vertex of a large prime in the graph of partial relations, created when it is new.
+static uint32_t qs_vertex(qs_shared_t *shared, const uint32_t prime) {
+    size_t h = (prime * 0x9E3779B1u) & (4 * QS_RELATIONS - 1);
+    if (prime == 1) return 0;
+    for (; shared->vertices[h][0] != prime; h = (h + 1) & (4 * QS_RELATIONS - 1))
+        if (shared->vertices[h][0] == 0) {
+            shared->vertices[h][0] = prime, shared->vertices[h][1] = (uint32_t) shared->vertex_count;
+            shared->forest[shared->vertex_count] = (uint32_t) shared->vertex_count;
+            ++shared->vertex_count;
+            break;
+        }
+    return shared->vertices[h][1];
+}
+
+static inline uint32_t qs_root(const qs_shared_t *shared, uint32_t v) {
+    for (; shared->forest[v] != v; v = shared->forest[v] = shared->forest[shared->forest[v]]);
+    return v;
+}
+
+// append a relation with its factor base indexes to the shared store, an edge closing a cycle makes a new full relation.
+static void qs_store(qs_shared_t *shared, const smooth_number_t *from, const uint16_t *list) {
+    smooth_number_t *rel = shared->relations + shared->count;
+    const uint32_t p = from->large[0], q = from->large[1];
+    uint32_t u, v;
+    if (shared->count == QS_RELATIONS || shared->pool_used + from->count > QS_RELATIONS * 24 || (p > 1 && shared->count + shared->j >= QS_RELATIONS))
+        return; // the remaining room is kept for the full relations.
+    *rel = *from, rel->index = (uint32_t) shared->pool_used;
+    memcpy(shared->pool + shared->pool_used, list, from->count * sizeof(uint16_t));
+    shared->pool_used += from->count, ++shared->count;
+    if (p == q || p == 1) // no large prime, or its square.
+        ++shared->counts.fulls;
+    else {
+        ++shared->counts.partials;
+        u = qs_root(shared, qs_vertex(shared, p)), v = qs_root(shared, qs_vertex(shared, q));
+        if (u == v) ++shared->counts.cycles;
+        else shared->forest[u] = v;
+    }
+}
+
+// hand the batch of a thread over to the shared store, a finished A is counted as merged.
+static void qs_flush(qs_sieve_t *qs, const int finished) {
+    qs_shared_t *shared = qs->shared;
+    size_t k;
+    QS_LOCK(shared);
+#ifndef QS_NO_THREADS
+    // in deterministic mode the batches of an A wait until all the previous A are merged.
+    while (shared->deterministic && !shared->done && shared->committed != qs->a_number)
+        pthread_cond_wait(&shared->turn, &shared->lock);
+#endif
+    for (k = 0; k < qs->count && !shared->done; ++k) {
+        qs_store(shared, qs->batch + k, qs->pool + qs->batch[k].index);
+        shared->done = shared->counts.fulls + shared->counts.cycles >= shared->j;
+    }
+    shared->counts.blocks += qs->blocks, shared->counts.candidates += qs->scanned;
+    if (finished && shared->deterministic) ++shared->committed;
+#ifndef QS_NO_THREADS
+    if (finished || shared->done) pthread_cond_broadcast(&shared->turn);
+#endif
+    qs->done = shared->done;
+    QS_UNLOCK(shared);
+    qs->count = qs->pool_used = qs->blocks = qs->scanned = 0;
+}
+
+// keep the relation X in the batch when its cofactor b is 1 or splits in large primes, the split doesn't depend on rand.
+static void qs_relation(qs_sieve_t *qs, const positive_number X, const size_t count, const positive_number b) {
+    const qs_shared_t *shared = qs->shared;
+    smooth_number_t *rel = qs->batch + qs->count;
+    positive_number p = b, q = 1;
+    montgomery_t mont;
+    if (b > shared->large) {
+        if (b > shared->large_2 || !(b & 1))
+            return;
+        mont_init(&mont, b); // a probable prime to the base 2 is a single prime too large.
+        if (mont_pow(&mont, mont_add(&mont, mont.one, mont.one), b - 1) == mont.one)
+            return;
+        p = rho_walk(b, 1 << 12, 2, 0), q = b / p;
+        if (p == 1 || p > shared->large || q > shared->large)
+            return;
+    }
+    rel->X = X;
+    rel->large[0] = (uint32_t) p, rel->large[1] = (uint32_t) q;
+    rel->index = (uint32_t) qs->pool_used, rel->count = (uint32_t) count;
+    qs->pool_used += count, ++qs->count;
+    if (qs->count == QS_BATCH || qs->pool_used + QS_FACTORS > QS_BATCH * 24)
+        qs_flush(qs, 0);
+}
+
+// sieve the block starting at x = x0 of the current polynomial, then store its smooth relations.
+static void qs_block(qs_sieve_t *qs, const long long x0) {
+    const qs_shared_t *shared = qs->shared;
+    fb_prime_t *base = qs->base;
+    const size_t d = shared->d, m = shared->m;
+    size_t g, i, l, n, q, n_hits;
+    positive_number b, X;
+    __int128_t x;
+    memset(qs->sieve, 128 - qs->threshold, m);
+    sieve_block(qs->sieve, base, shared->s_from, d, (uint32_t) m);
+    for (i = 1; i < shared->s_from; ++i) // the small primes are not sieved, their roots move anyway.
+        for (g = 0; g < 2; ++g)
+            base[i].root[g] = (uint32_t) ((base[i].root[g] + base[i].p - m % base[i].p) % base[i].p);
+    n = sieve_scan(qs->sieve, (uint32_t) m, qs->candidates, m >> 4);
+    ++qs->blocks, qs->scanned += n;
+    if (n == 0) return;
+    // resieve the large primes over the block, remembering which of them hit a candidate.
+    for (i = shared->r_from, n_hits = 0; i < d; ++i)
+        if (base[i].log)
+            for (g = 0; g < 1 + (base[i].root[0] != base[i].root[1]); ++g)
+                for (q = (base[i].root[g] + m) % base[i].p; q < m && n_hits < m; q += base[i].p)
+                    if (qs->sieve[q] & 0x80) qs->hits[n_hits][0] = (uint32_t) q, qs->hits[n_hits++][1] = (uint32_t) i;
+    for (l = 0; l < n && !qs->done; ++l) {
+        uint16_t *list = qs->pool + qs->pool_used;
+        const uint32_t o = qs->candidates[l];
+        size_t c = 0;
+        x = (__int128_t) qs->A * (x0 + o) + qs->B;
+        X = (positive_number) (x < 0 ? -x : x);
+        // the residue is |X^2 - N| / A, -1 is the index 0.
+        b = X * X;
+        if (b < shared->n) b = shared->n - b, list[c++] = 0;
+        else b -= shared->n;
+        b /= qs->A;
+        for (g = 0; g < shared->s; ++g) { // the primes of A are not sieved.
+            i = qs->a_index[g];
+            for (list[c++] = (uint16_t) i; b % base[i].p == 0 && c < QS_FACTORS; b /= base[i].p, list[c++] = (uint16_t) i);
+        }
+        // the residue is divided only by the primes whose roots meet the candidate.
+        for (i = 1, q = 0; i < d; ++i) {
+            if (i < shared->r_from) {
+                const long long r = (long long) o - (long long) m, p = base[i].p; // roots are for the next block.
+                if (!base[i].log && i >= shared->s_from) continue;
+                if ((r - base[i].root[0]) % p && (r - base[i].root[1]) % p) continue;
+            } else {
+                for (; q < n_hits && (qs->hits[q][0] != o || qs->hits[q][1] < i); ++q);
+                if (q == n_hits) break;
+                i = qs->hits[q++][1];
+            }
+            for (; b % base[i].p == 0 && c < QS_FACTORS; b /= base[i].p, list[c++] = (uint16_t) i);
+        }
+        if (c < QS_FACTORS)
+            qs_relation(qs, X, c, b);
+    }
+}
+
+// draw the next coefficient A close to sqrt(2 N) / M from primes of the base, the sequence of A doesn't depend on the threads.
+// returns 0 and ends the sieve once the whole base yields no new A.
+static positive_number qs_choose_a(qs_shared_t *shared, size_t *a_index) {
+    const fb_prime_t *base = shared->base;
+    const size_t d = shared->d, s = shared->s;
+    positive_number A;
+    size_t g, i, l, lo, hi, from, to, tries;
+    const double target = ((bit_length(shared->n) + 1) >> 1) - log2((double) shared->M), each = target / (double) s;
+    // the first s - 1 primes are drawn around the s-th root of the target, the last one completes the product.
+    for (lo = shared->s_from; lo < d - 1 && log2((double) base[lo].p) < each - .5; ++lo);
+    for (hi = lo; hi < d - 1 && log2((double) base[hi].p) < each + .5; ++hi);
+    if (hi - lo < 4 * s) lo = lo > shared->s_from + 2 * s ? lo - 2 * s : shared->s_from, hi = lo + 4 * s < d ? lo + 4 * s : d;
+    for (from = lo, to = hi, tries = 0;; ++tries) {
+        if (tries == QS_A_TRIES) { // the range is exhausted, it widens by s primes on each side.
+            if (lo == shared->s_from && hi == d) return shared->done = 1, 0;
+            shared->a_wide += s, tries = 0;
+        }
+        lo = from > shared->s_from + shared->a_wide ? from - shared->a_wide : shared->s_from;
+        hi = to + shared->a_wide < d ? to + shared->a_wide : d;
+        for (A = 1, l = 0; l < s; ++l) {
+            if (l + 1 < s || s == 1)
+                do {
+                    shared->seed = shared->seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                    i = lo + (size_t) (shared->seed >> 33) % (hi - lo);
+                    for (g = 0; g < l && a_index[g] != i; ++g);
+                } while (g < l || !base[i].sqrt_n); // the primes of the multiplier have a single root.
+            else {
+                const double rest = target - log2((double) A);
+                for (i = shared->s_from; i < d - 1 && log2((double) base[i].p) < rest; ++i);
+                for (;; i = i + 1 < d ? i + 1 : shared->s_from) { // the last prime must differ from the others.
+                    for (g = 0; g < l && a_index[g] != i; ++g);
+                    if (g == l && base[i].sqrt_n) break;
                 }
-                *mr_ptr++ = f ;
-                *mr_ptr++ = l - f ;
-            } else
-                *mr_ptr += 2;
-            *mr_ptr++ = l ;
-        }
-    d = (mr_ptr - m_roots) / 3;
-    j = d + 5;
-    k = 0;
+            }
+            a_index[l] = i, A *= base[i].p;
+        }
+        for (g = 0; g < shared->a_count && g < QS_A_USED && shared->a_used[g] != A; ++g);
+        if (g == shared->a_count || g == QS_A_USED) break;
+    }
+    if (shared->a_count < QS_A_USED) shared->a_used[shared->a_count] = A;
+    ++shared->a_count;
+    return A;
+}
+
+// take a new coefficient A then prepare its first polynomial in the base of the thread.
+static void qs_polynomial_a(qs_sieve_t *qs) {
+    qs_shared_t *shared = qs->shared;
+    fb_prime_t *base = qs->base;
+    const size_t d = shared->d, s = shared->s, M = shared->M;
+    positive_number A;
+    size_t i, l;
+    uint32_t p, r;
+    for (l = 0; l < s && qs->A > 1; ++l) // the primes of the previous A are sieved again.
+        base[qs->a_index[l]].log = (unsigned char) (0.5 + log2((double) base[qs->a_index[l]].p));
+    QS_LOCK(shared);
+    qs->a_number = shared->a_count;
+    qs->A = A = qs_choose_a(shared, qs->a_index);
+    QS_UNLOCK(shared);
+    if (!A) { // no new A is left, the sieve ends with the relations found.
+        qs->done = 1;
+        return;
+    }
+    for (l = 0; l < s; base[qs->a_index[l++]].log = 0);
+    // B_l = A / q_l * (sqrt(N) / (A / q_l) mod q_l) squares to N modulo q_l and vanishes modulo the other primes.
+    for (qs->B = 0, l = 0; l < s; ++l) {
+        p = base[qs->a_index[l]].p;
+        r = (uint32_t) ((positive_number) base[qs->a_index[l]].sqrt_n * inverse_mod((uint32_t) (A / p % p), p) % p);
+        qs->B_l[l] = A / p * (r > p / 2 ? p - r : r);
+        qs->B += qs->B_l[l];
+    }
+    for (i = 1; i < d; ++i) {
+        if (!base[i].log) continue;
+        p = base[i].p;
+        const uint32_t ainv = base[i].ainv = inverse_mod((uint32_t) (A % p), p), b = (uint32_t) ((positive_number) qs->B % p);
+        for (l = 0; l < s; ++l)
+            qs->b_ainv[l * d + i] = (uint32_t) (2 * (qs->B_l[l] % p) * ainv % p);
+        // the roots of (A x + B)^2 - N are x = (+-sqrt(N) - B) / A, the sieve offset o is x + M.
+        base[i].first[0] = (uint32_t) (((uint64_t) ainv * ((base[i].sqrt_n + p - b) % p) + M) % p);
+        base[i].first[1] = (uint32_t) (((uint64_t) ainv * ((2 * p - base[i].sqrt_n - b) % p) + M) % p);
+    }
+}
+
+// move to the next B of the Gray code, B += 2 e B_v, each root moves by -e 2 B_v / A modulo p with additions only.
+static void qs_polynomial_b(qs_sieve_t *qs, const size_t index) {
+    fb_prime_t *base = qs->base;
+    const size_t v = (size_t) __builtin_ctzll(index), d = qs->shared->d;
+    const int e = (index >> (v + 1)) & 1;
+    const uint32_t *delta = qs->b_ainv + v * d;
+    qs->B += e ? 2 * (__int128_t) qs->B_l[v] : -2 * (__int128_t) qs->B_l[v];
+    for (size_t i = 1; i < d; ++i)
+        if (base[i].log) {
+            const uint32_t p = base[i].p, step = e ? p - delta[i] : delta[i]; // subtracting delta is adding p - delta.
+            for (size_t g = 0; g < 2; ++g)
+                base[i].first[g] = base[i].first[g] + step >= p ? base[i].first[g] + step - p : base[i].first[g] + step;
+        }
+}
+
+// carve the arena of a sieving thread from memory with its own copy of the base, returns the end of the arena.
+static void *qs_worker_init(qs_sieve_t *qs, qs_shared_t *shared, void *memory) {
+    memset(qs, 0, sizeof(*qs));
+    qs->shared = shared, qs->A = 1, qs->threshold = shared->threshold;
+    qs->base = mem_straight(memory);
+    memcpy(qs->base, shared->base, shared->d * sizeof(fb_prime_t));
+    qs->sieve = mem_straight(qs->base + shared->d);
+    qs->candidates = mem_straight(qs->sieve + shared->m);
+    qs->hits = mem_straight(qs->candidates + (shared->m >> 4));
+    qs->b_ainv = mem_straight(qs->hits + shared->m);
+    qs->batch = mem_straight(qs->b_ainv + QS_A_FACTORS * shared->d);
+    qs->pool = mem_straight(qs->batch + QS_BATCH);
+    return mem_straight(qs->pool + QS_BATCH * 24);
+}
+
+// sieving thread of the self-initializing mode, each A is sieved by one thread over [-M, M) for all its B.
+static void *qs_worker(void *arg) {
+    qs_sieve_t *qs = arg;
+    const qs_shared_t *shared = qs->shared;
+    const size_t d = shared->d, M = shared->M, m = shared->m;
+    size_t g, h, i;
+    while (!qs->done) {
+        qs_polynomial_a(qs);
+        for (h = 0; h < (size_t) 1 << (shared->s - 1) && !qs->done; ++h) {
+            if (h) qs_polynomial_b(qs, h);
+            for (i = 1; i < d; ++i)
+                qs->base[i].root[0] = qs->base[i].first[0], qs->base[i].root[1] = qs->base[i].first[1];
+            for (g = 0; g < 2 * M && !qs->done; g += m) {
+                qs_block(qs, (long long) g - (long long) M);
+                if (!shared->deterministic) qs_flush(qs, 0); // the other threads learn early that the sieve is done.
+            }
+        }
+        qs_flush(qs, 1);
+    }
+    return 0;
+}
+
+typedef void gf2_xor_t(uint64_t *restrict lhs, const uint64_t *restrict rhs, size_t from, size_t words);
+
+// rows of a GF(2) matrix hold 64 columns per word, their length is a multiple of 8 words so the widest XOR has no tail.
+static inline void gf2_xor(uint64_t *restrict lhs, const uint64_t *restrict rhs, size_t from, const size_t words) {
+#if defined(__AVX512F__)
+    for (from &= ~(size_t) 7; from < words; from += 8)
+        _mm512_storeu_si512((void *) (lhs + from), _mm512_xor_si512(_mm512_loadu_si512((const void *) (lhs + from)), _mm512_loadu_si512((const void *) (rhs + from))));
+#elif defined(__AVX2__)
+    for (from &= ~(size_t) 3; from < words; from += 4)
+        _mm256_storeu_si256((__m256i *) (lhs + from), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (lhs + from)), _mm256_loadu_si256((const __m256i *) (rhs + from))));
+#else
+    for (; from < words; ++from)
+        lhs[from] ^= rhs[from];
+#endif
+}
+
+#ifdef QS_XOR_DISPATCH
+__attribute__((target("avx512f"))) static void gf2_xor_512(uint64_t *restrict lhs, const uint64_t *restrict rhs, size_t from, const size_t words) {
+    for (from &= ~(size_t) 7; from < words; from += 8)
+        _mm512_storeu_si512((void *) (lhs + from), _mm512_xor_si512(_mm512_loadu_si512((const void *) (lhs + from)), _mm512_loadu_si512((const void *) (rhs + from))));
+}
+
+__attribute__((target("avx2"))) static void gf2_xor_256(uint64_t *restrict lhs, const uint64_t *restrict rhs, size_t from, const size_t words) {
+    for (from &= ~(size_t) 3; from < words; from += 4)
+        _mm256_storeu_si256((__m256i *) (lhs + from), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (lhs + from)), _mm256_loadu_si256((const __m256i *) (rhs + from))));
+}
+#endif
+
+// the widest XOR of the host, gf2_xor itself when the compiler flags already chose it.
+static gf2_xor_t *gf2_xor_select(void) {
+#ifdef QS_XOR_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return gf2_xor_512;
+    if (__builtin_cpu_supports("avx2")) return gf2_xor_256;
+#endif
+    return gf2_xor;
+}
+
+// Gaussian elimination over the first columns with rows swapped by pointer, returns the rank : the next rows are null over those columns.
+static size_t gf2_eliminate(uint64_t **rows, const size_t n, const size_t columns, const size_t words) {
+    gf2_xor_t *const xor_rows = gf2_xor_select();
+    size_t e = 0, f, g;
+    uint64_t *t;
+    for (f = 0; f < columns && e < n; ++f) {
+        const size_t w = f >> 6;
+        const uint64_t bit = 1ULL << (f & 63);
+        for (g = e; g < n && !(rows[g][w] & bit); ++g);
+        if (g == n) continue;
+        t = rows[g], rows[g] = rows[e], rows[e] = t;
+        for (g = e + 1; g < n; ++g)
+            if (rows[g][w] & bit) // the words before w are null in both rows.
+                xor_rows(rows[g], rows[e], w, words);
+        ++e;
+    }
+    return e;
+}
+
+// spanning forest of the graph of partial relations, each edge outside of it closes a cycle which becomes a matrix row.
+static size_t qs_cycles(qs_shared_t *shared, uint32_t *rows, uint32_t *row_rels, size_t r, void *memory) {
+    const size_t V = shared->vertex_count;
+    size_t e, g, h, n = rows[r];
+    uint32_t *edge_u = mem_straight(memory), *edge_v = mem_straight(edge_u + shared->count), *start = mem_straight(edge_v + shared->count);
+    uint32_t *adjacent = mem_straight(start + V + 1), *parent = mem_straight(adjacent + 4 * shared->count), *depth = mem_straight(parent + V);
+    uint32_t *queue = mem_straight(depth + V);
+    memset(start, 0, (V + 1) * sizeof(uint32_t));
+    for (e = 0; e < shared->count; ++e)
+        if (shared->relations[e].large[0] != shared->relations[e].large[1] && shared->relations[e].large[0] > 1) {
+            edge_u[e] = qs_vertex(shared, shared->relations[e].large[0]), edge_v[e] = qs_vertex(shared, shared->relations[e].large[1]);
+            ++start[edge_u[e] + 1], ++start[edge_v[e] + 1];
+        } else edge_u[e] = edge_v[e] = UINT32_MAX;
+    for (g = 0; g < V; start[g + 1] += start[g], ++g);
+    for (e = 0; e < shared->count; ++e) // adjacency pairs (vertex, edge), start is shifted back by the filling.
+        if (edge_u[e] != UINT32_MAX) {
+            adjacent[2 * start[edge_u[e]]] = edge_v[e], adjacent[2 * start[edge_u[e]]++ + 1] = (uint32_t) e;
+            adjacent[2 * start[edge_v[e]]] = edge_u[e], adjacent[2 * start[edge_v[e]]++ + 1] = (uint32_t) e;
+        }
+    for (g = V; g; start[g] = start[g - 1], --g);
+    start[0] = 0;
+    // breadth first search, parent holds the edge leading to each vertex.
+    memset(parent, 0xff, V * sizeof(uint32_t));
+    for (g = 0; g < V; ++g)
+        if (parent[g] == UINT32_MAX) {
+            size_t head = 0, tail = 0;
+            depth[queue[tail++] = (uint32_t) g] = 0, parent[g] = UINT32_MAX - 1;
+            for (; head < tail; ++head)
+                for (h = start[queue[head]]; h < start[queue[head] + 1]; ++h)
+                    if (parent[adjacent[2 * h]] == UINT32_MAX) {
+                        parent[adjacent[2 * h]] = adjacent[2 * h + 1], depth[adjacent[2 * h]] = depth[queue[head]] + 1;
+                        queue[tail++] = adjacent[2 * h];
+                    }
+        }
+    for (e = 0; e < shared->count && r < shared->j; ++e)
+        if (edge_u[e] != UINT32_MAX && parent[edge_u[e]] != e && parent[edge_v[e]] != e) {
+            uint32_t u = edge_u[e], v = edge_v[e], w;
+            for (h = n, row_rels[h++] = (uint32_t) e; u != v && h < QS_RELATIONS; row_rels[h++] = parent[w]) {
+                w = depth[u] >= depth[v] ? u : v;
+                if (w == u) u = edge_u[parent[w]] == w ? edge_v[parent[w]] : edge_u[parent[w]];
+                else v = edge_u[parent[w]] == w ? edge_v[parent[w]] : edge_u[parent[w]];
+            }
+            if (u == v) rows[++r] = (uint32_t) (n = h);
+        }
+    return r;
+}
+
+static int qs_compare(const void *lhs, const void *rhs) {
+    return (*(const uint32_t *) lhs > *(const uint32_t *) rhs) - (*(const uint32_t *) lhs < *(const uint32_t *) rhs);
+}
+
+// sparse matrix, a row is the sorted list of the columns of its odd exponents and the sum of the sorted list of rows of relations at origin.
+typedef struct {
+    uint32_t *start, *length, *origin, *origins, *stamp, *live; // by row, a deleted row has the length UINT32_MAX.
+    uint32_t *weight, (*slot)[QS_MERGE], *column;               // by column, slot holds the rows of the light columns.
+    uint32_t *lists;                                            // the lists, those of the merged rows are appended.
+    uint32_t *lengths;                                          // histogram of the row lengths, the last of its 256 counts holds the longer rows.
+    size_t j, d, used, room;
+} qs_matrix_t;
+
+// lists of the odd exponents of the rows of relations, returns the end of the memory in use.
+static void *qs_matrix_init(qs_matrix_t *mx, const qs_shared_t *shared, const uint32_t *rows, const uint32_t *row_rels, const size_t j, void *memory) {
+    const size_t d = shared->d;
+    size_t g, h, l, n, most;
+    uint32_t *scratch;
+    mx->j = j, mx->d = d;
+    mx->start = mem_straight(memory), mx->length = mem_straight(mx->start + j), mx->origin = mem_straight(mx->length + j);
+    mx->origins = mem_straight(mx->origin + j), mx->stamp = mem_straight(mx->origins + j), mx->live = mem_straight(mx->stamp + j);
+    mx->weight = mem_straight(mx->live + j), mx->slot = mem_straight(mx->weight + d), mx->column = mem_straight(mx->slot + d);
+    mx->lengths = mem_straight(mx->column + d), scratch = mem_straight(mx->lengths + 256);
+    for (g = 0, most = 0; g < j; most = n > most ? n : most, ++g)
+        for (h = rows[g], n = 0; h < rows[g + 1]; n += shared->relations[row_rels[h++]].count);
+    mx->lists = mem_straight(scratch + most);
+    for (g = 0, mx->used = 0; g < j; ++g) {
+        for (h = rows[g], n = 0; h < rows[g + 1]; ++h)
+            for (l = 0; l < shared->relations[row_rels[h]].count; ++l)
+                scratch[n++] = shared->pool[shared->relations[row_rels[h]].index + l];
+        qsort(scratch, n, sizeof(uint32_t), qs_compare);
+        mx->start[g] = (uint32_t) mx->used, mx->stamp[g] = 0;
+        for (h = 0; h < n; h = l) {
+            for (l = h + 1; l < n && scratch[l] == scratch[h]; ++l);
+            if ((l - h) & 1) mx->lists[mx->used++] = scratch[h];
+        }
+        mx->length[g] = (uint32_t) (mx->used - mx->start[g]);
+        mx->origin[g] = (uint32_t) mx->used, mx->origins[g] = 1, mx->lists[mx->used++] = (uint32_t) g;
+    }
+    mx->room = QS_ROOM * mx->used;
+    return mx->lists + mx->room;
+}
+
+// symmetric difference of the sorted lists [u, U) and [v, V) written at w, returns its end.
+static uint32_t *qs_xor_lists(const uint32_t *u, const uint32_t *U, const uint32_t *v, const uint32_t *V, uint32_t *w) {
+    while (u < U || v < V)
+        if (v == V || (u < U && *u < *v)) *w++ = *u++;
+        else if (u == U || *v < *u) *w++ = *v++;
+        else ++u, ++v;
+    return w;
+}
+
+// row g is added to row h, the lists of h are rebuilt at the end of the lists.
+static void qs_merge(qs_matrix_t *mx, const uint32_t g, const uint32_t h) {
+    uint32_t *l = mx->lists, *w = l + mx->used;
+    w = qs_xor_lists(l + mx->start[g], l + mx->start[g] + mx->length[g], l + mx->start[h], l + mx->start[h] + mx->length[h], w);
+    mx->length[h] = (uint32_t) (w - l - mx->used), mx->start[h] = (uint32_t) mx->used, mx->used = (size_t) (w - l);
+    w = qs_xor_lists(l + mx->origin[g], l + mx->origin[g] + mx->origins[g], l + mx->origin[h], l + mx->origin[h] + mx->origins[h], w);
+    mx->origins[h] = (uint32_t) (w - l - mx->used), mx->origin[h] = (uint32_t) mx->used, mx->used = (size_t) (w - l);
+}
+
+// structured elimination : the rows holding a column of weight 1 are deleted, the lightest row of a column of weight up to
+// QS_MERGE is added to the others then deleted. each step removes a row and at least a column, so the excess of rows is kept,
+// the heaviest rows beyond QS_EXCESS are deleted. returns the rows left, listed by live.
+static size_t qs_filter(qs_matrix_t *mx) {
+    uint32_t *const count = mx->column, *const lengths = mx->lengths; // rows found by column, the column map is built after the filter.
+    size_t c, g, h, k, w, pass, progress, R, C;
+    for (pass = 1, progress = 1; progress; ++pass) {
+        // the rows changed by a pass are stamped, the weights of their columns are counted again by the next one.
+        memset(mx->weight, 0, mx->d * sizeof(uint32_t));
+        memset(count, 0, mx->d * sizeof(uint32_t));
+        for (g = 0; g < mx->j; ++g)
+            for (h = 0; mx->length[g] != UINT32_MAX && h < mx->length[g]; ++mx->weight[mx->lists[mx->start[g] + h++]]);
+        for (g = 0; g < mx->j; ++g)
+            for (h = 0; mx->length[g] != UINT32_MAX && h < mx->length[g]; ++h)
+                if (c = mx->lists[mx->start[g] + h], mx->weight[c] <= QS_MERGE)
+                    mx->slot[c][count[c]++] = (uint32_t) g;
+        for (c = 0, progress = 0; c < mx->d; ++c) {
+            if (!(w = mx->weight[c]) || w > QS_MERGE) continue;
+            for (k = 0, g = mx->slot[c][0], h = 0; k < w && mx->stamp[mx->slot[c][k]] != pass; ++k) {
+                g = mx->length[mx->slot[c][k]] < mx->length[g] ? mx->slot[c][k] : g;
+                h += mx->length[mx->slot[c][k]] + mx->origins[mx->slot[c][k]];
+            }
+            if (k < w || mx->used + h + (w - 2) * (mx->length[g] + mx->origins[g]) > mx->room) continue;
+            for (k = 0; k < w; ++k)
+                if (mx->slot[c][k] != g) qs_merge(mx, (uint32_t) g, mx->slot[c][k]);
+            for (k = 0; k < w; mx->stamp[mx->slot[c][k++]] = (uint32_t) pass);
+            mx->length[g] = UINT32_MAX, progress = 1;
+        }
+        if (progress) continue;
+        for (c = 0, C = 0; c < mx->d; C += mx->weight[c++] != 0);
+        for (g = 0, R = 0; g < mx->j; R += mx->length[g++] != UINT32_MAX);
+        if (R <= C + QS_EXCESS) break;
+        // the rows longer than h are deleted, then the rows of length h until the excess is reached.
+        memset(lengths, 0, 256 * sizeof(uint32_t));
+        for (g = 0; g < mx->j; ++g)
+            if (mx->length[g] != UINT32_MAX) ++lengths[mx->length[g] < 255 ? mx->length[g] : 255];
+        for (h = 255, c = R - C - QS_EXCESS; lengths[h] < c; c -= lengths[h--]);
+        for (g = 0; g < mx->j; ++g)
+            if (mx->length[g] != UINT32_MAX && (mx->length[g] > h || (mx->length[g] == h && c && c--)))
+                mx->length[g] = UINT32_MAX, progress = 1;
+    }
+    for (g = 0, R = 0; g < mx->j; ++g)
+        if (mx->length[g] != UINT32_MAX) mx->live[R++] = (uint32_t) g;
+    return R;
+}
+
+// Knuth-Schroeppel multiplier of n : k n has the most small primes among its quadratic residues, against the sqrt(k) growth
+// of the residues. the multipliers are odd and squarefree, k n stays below 2^127 so that the squares X^2 hold in 128 bits.
+static unsigned qs_multiplier(const positive_number n) {
+    static const unsigned char multipliers[] = {1, 3, 5, 7, 11, 13, 15, 17, 19, 21, 23, 29, 31, 33, 35, 37, 39, 41, 43, 47, 51, 53, 55, 57, 59, 61, 65, 67, 69, 71, 73};
+    const size_t K = sizeof(multipliers);
+    double score[sizeof(multipliers)], best = -HUGE_VAL;
+    unsigned char square[1024];
+    uint32_t i, p, r, res = 1;
+    size_t k;
+    for (k = 0; k < K; ++k) { // k n = 1 modulo 8 gets twice the factor 2 on average, 5 once, 3 and 7 half of it.
+        r = (uint32_t) (multipliers[k] * (uint32_t) (n & 7) & 7);
+        score[k] = (r == 1 ? 2 : r == 5 ? 1 : .5) * log(2.) - .5 * log((double) multipliers[k]);
+    }
+    for (p = 3; p < sizeof(square); p += 2)
+        if (is_prime(p)) {
+            memset(square, 0, p);
+            for (i = 1; i <= p / 2; square[i * i % p] = 1, ++i);
+            for (r = (uint32_t) (n % p), k = 0; k < K; ++k)
+                if (multipliers[k] % p == 0) score[k] += log((double) p) / p;
+                else if (square[multipliers[k] * r % p]) score[k] += 2 * log((double) p) / (p - 1);
+        }
+    for (k = 0; k < K; ++k)
+        if (score[k] > best && n < ((positive_number) 255 << 119) / multipliers[k])
+            best = score[k], res = multipliers[k];
+    return res;
+}
+
+// parameters of the sieve over numbers of the given bits, from the table.
+static qs_params_t qs_params_of(const int bits) {
+    const size_t rows = sizeof(qs_params) / sizeof(*qs_params);
+    qs_params_t res;
+    size_t i;
+    double f;
+    for (i = 0; i + 2 < rows && qs_params[i + 1].bits <= bits; ++i);
+    res = qs_params[i], f = (double) (bits - res.bits) / (qs_params[i + 1].bits - res.bits);
+    if (f > 0) // the bound grows geometrically up to the next row.
+        res.bound = (uint32_t) (res.bound * pow((double) qs_params[i + 1].bound / res.bound, f < 1 ? f : 1));
+    return res;
+}
+
+// factor an odd composite number that is not a perfect power with the quadratic sieve, config and stats may be null.
+positive_number quadratic_sieve(const positive_number number, void *memory, const qs_config_t *config, factor_stats_t *stats) {
+    double t = stats ? wall_time() : 0;
+    const unsigned multiplier = qs_multiplier(number);
+    const positive_number kn = number * multiplier; // the sieve runs over k N, the dependencies split N.
+    const qs_params_t params = qs_params_of(bit_length(kn));
+    positive_number a, b, c;
+    size_t d, e, f, g, h, i, j, k, l, m, M, R, C;
+    uint32_t *exponent, *large;
+    montgomery_t mont;
+    fb_prime_t *base;
+    uint64_t **matrix, *bits;
+    uint32_t *rows, *row_rels;
+    qs_shared_t shared;
+    qs_sieve_t qs;
+    qs_matrix_t mx;
+    void *end;
+    for (b = kn >> 1, a = (b + kn / b) >> 1; a < b; b = a, a = (b + kn / b) >> 1);
+    a += a * a != kn;
+    d = params.bound, m = params.block;
+    base = mem_straight(memory);
+    memset(base, 0, sizeof(fb_prime_t));
+    base[0].p = 1; // stands for -1.
+    for (l = 2, h = 1; l < d; l += 1 + (l & 1))
+        if (is_prime(l)) {
+            if (number % l == 0) {
+                if (stats) stats->seconds[STAGE_SIEVE] += wall_time() - t;
+                return l; // number has a factor in the base.
+            }
+            if (multiplier % l == 0)
+                f = 0; // a prime of the multiplier has a single root, half its logarithm is added there twice.
+            else if (mod_pow(kn % l, (l - 1) >> 1, l) != 1)
+                continue;
+            else if (3 == (l & 3))
+                f = mod_pow(kn, (l + 1) >> 2, l);
+            else {
+                for (f = l - 1, i = 0; !(f & 1); f >>= 1, ++i);
+                for (g = 2; 1 + mod_pow(g, (l - 1) >> 1, l) != l; ++g);
+                for (g = mod_pow(g, f, l), f = mod_pow(kn, (f + (k = 1)) >> 1, l), j = mod_pow(kn, l - 2, l); k;
+                     k ? (f = multiplication_modulo(f, (e = i - k - 1) ? mod_pow(g, 1 << e, l) : g, l)) : 0)
+                    for (k = 0, e = multiplication_modulo(mod_pow(f, 2, l), j, l);
+                         e != 1; ++k, e = mod_pow(e, 2, l));
+            }
+            base[h].p = (uint32_t) l, base[h].sqrt_n = (uint32_t) f, base[h].ainv = 1;
+            base[h].log = (unsigned char) (0.5 + log2((double) l) / (f ? 1 : 2));
+            // the single polynomial sieve starts at x = ceil(sqrt(N)), roots of x^2 - N relative to it.
+            g = (size_t) (a % l);
+            base[h].root[0] = (uint32_t) ((f + l - g) % l);
+            base[h].root[1] = (uint32_t) ((2 * l - f - g) % l);
+            ++h;
+        }
+    d = h;
+    j = d + params.extra;
+    memset(&shared, 0, sizeof(shared));
+    shared.n = kn, shared.base = base, shared.d = d, shared.j = j, shared.m = m;
+    shared.deterministic = config && config->deterministic;
+    for (shared.s_from = 1; shared.s_from < d && base[shared.s_from].p < QS_SKIP; ++shared.s_from);
+    for (shared.r_from = shared.s_from; shared.r_from < d && base[shared.r_from].p < QS_RESIEVE;)
+        ++shared.r_from;
+    shared.large = (uint64_t) base[d - 1].p << QS_LARGE;
+    shared.large = shared.large > UINT32_MAX ? UINT32_MAX : shared.large;
+    shared.large_2 = shared.large * base[d - 1].p << QS_LARGE_2;
+    shared.tolerance = (unsigned char) (bit_length(shared.large_2) - params.threshold);
+    if (bit_length(kn) >= QS_SIQS) {
+        // self-initializing sieve over [-M, M), the residues stay below M sqrt(N / 2).
+        M = shared.M = m * params.blocks, shared.seed = (uint64_t) (number ^ number >> 64);
+        e = bit_length(kn) / 2 + bit_length(M) - 1;
+        shared.threshold = (unsigned char) (e > shared.tolerance ? e - shared.tolerance : 0);
+        // the primes of A have about 12 bits, fewer when the base is too small to hold many of them.
+        f = (size_t) bit_length(base[d - 1].p) - 3, f = f < 12 ? f : 12;
+        for (shared.s = 1; shared.s < QS_A_FACTORS && (double) (bit_length(kn) / 2 - bit_length(M)) / (double) shared.s > (double) f; ++shared.s);
+    }
     {
         // memory management
-        f = j * d;
-        M_1 = mem_straight(m_roots + 3 * d);
-        M_2 = mem_straight(M_1 + f);
-        memset(M_1, 0, f + f);
-        T = mem_straight(M_2 + f);
-        x_squared = mem_straight(T + j);
-        smooth_numbers = mem_straight(x_squared + m);
-        char *ptr = base_reset_fact = mem_straight(smooth_numbers + j);
-        e = d + (32 - d) % 32;
-        l = e * m;
-        for (g = 0; g < m; x_squared[g].factors_vect = ptr, ptr += e, ++g);
-        for (g = 0; g < j; smooth_numbers[g].factors_vect = ptr, ptr += e, ++g);
-    }
-    for (f = h = (size_t) a; k < j; f = h) {
-        for (e = 0; e < m; x_squared[e].values[1] = (x_squared[e].values[0] = h) * h - number, ++h, ++e);
-        memset(base_reset_fact, 0, l);
-        for (e = 0, g = 0, mr_ptr = m_roots; e < d; ++e, mr_ptr += 3)
-            do {
-                b = f - *(mr_ptr + g);
-                b = (b / *(mr_ptr + 2) + (b % *(mr_ptr + 2) != 0)) * *(mr_ptr + 2) + *(mr_ptr + g) - f;
-                for (a = b; a < m; a += *(mr_ptr + 2)) {
-                    for (i = 0; !(x_squared[a].values[1] % *(mr_ptr + 2)); x_squared[a].values[1] /= *(mr_ptr + 2), ++i);
-                    x_squared[a].factors_vect[e] = (char) (i & 1);
-                    if (x_squared[a].values[1] == 1 && k < j) {
-                        smooth_numbers[k].values[1] = (smooth_numbers[k].values[0] = x_squared[a].values[0]) * x_squared[a].values[0] - number;
-                        memcpy(M_1 + k * d, x_squared[a].factors_vect, d);
-                        M_2[k * (1 + d)] = (char) (k < d);
-                        ++k;
-                    }
+        shared.a_used = mem_straight(base + d);
+        shared.relations = mem_straight(shared.a_used + QS_A_USED);
+        shared.pool = mem_straight(shared.relations + QS_RELATIONS);
+        shared.vertices = mem_straight(shared.pool + QS_RELATIONS * 24);
+        shared.forest = mem_straight(shared.vertices + 4 * QS_RELATIONS);
+        memset(shared.vertices, 0, 4 * QS_RELATIONS * sizeof(*shared.vertices));
+        shared.vertex_count = 1, shared.forest[0] = 0;
+        end = qs_worker_init(&qs, &shared, shared.forest + 2 * QS_RELATIONS + 1);
+    }
+#ifndef QS_NO_THREADS
+    pthread_mutex_init(&shared.lock, 0);
+    pthread_cond_init(&shared.turn, 0);
+#endif
+    if (bit_length(kn) < QS_SIQS)
+        for (qs.B = (__int128_t) a, h = 0; !qs.done; h += m) {
+            // the threshold follows the size of the residues at the end of the block.
+            e = bit_length(((positive_number) a + h + m) * (a + h + m) - kn);
+            qs.threshold = (unsigned char) (e > shared.tolerance ? e - shared.tolerance : 0);
+            qs_block(&qs, (long long) h);
+            qs_flush(&qs, 0);
+        }
+#ifndef QS_NO_THREADS
+    else if (config && config->threads > 1) {
+        // the other threads get arenas of the same size as the first one, the calling thread sieves too.
+        const size_t size = (size_t) ((char *) end - (char *) qs.base) + 512, n = config->threads - 1;
+        pthread_t *thread = malloc(n * sizeof(pthread_t));
+        qs_sieve_t *worker = malloc(n * sizeof(qs_sieve_t));
+        char *arena = malloc(n * size);
+        for (i = 0; thread && worker && arena && i < n; ++i) {
+            qs_worker_init(worker + i, &shared, arena + i * size);
+            if (pthread_create(thread + i, 0, qs_worker, worker + i)) break;
+        }
+        qs_worker(&qs);
+        while (i) pthread_join(thread[--i], 0);
+        free(arena), free(worker), free(thread);
+    }
+#endif
+    else qs_worker(&qs);
+#ifndef QS_NO_THREADS
+    pthread_cond_destroy(&shared.turn);
+    pthread_mutex_destroy(&shared.lock);
+#endif
+    if (stats) {
+        stats->counts.fulls += shared.counts.fulls, stats->counts.partials += shared.counts.partials;
+        stats->counts.cycles += shared.counts.cycles, stats->counts.blocks += shared.counts.blocks;
+        stats->counts.candidates += shared.counts.candidates, stats->base = d, ++stats->sieves;
+        stats->seconds[STAGE_SIEVE] += wall_time() - t, t = wall_time();
+    }
+    // the rows of the matrix are the full relations then the cycles, as lists of relations.
+    rows = mem_straight(end);
+    row_rels = mem_straight(rows + j + 1);
+    for (rows[0] = 0, g = 0, k = 0; g < shared.count && k < j; ++g)
+        if (shared.relations[g].large[0] == shared.relations[g].large[1] || shared.relations[g].large[0] == 1)
+            row_rels[k] = (uint32_t) g, rows[k + 1] = (uint32_t) k + 1, ++k;
+    k = qs_cycles(&shared, rows, row_rels, k, mem_straight(row_rels + QS_RELATIONS));
+    j = k;
+    end = qs_matrix_init(&mx, &shared, rows, row_rels, j, mem_straight(row_rels + rows[j]));
+    R = qs_filter(&mx);
+    for (i = 0, C = 0; i < d; ++i)
+        mx.column[i] = mx.weight[i] ? (uint32_t) C++ : UINT32_MAX;
+    {
+        // memory management, a row of the core holds the parities of the exponents then the identity that tracks the combinations.
+        f = ((C + R + 63) / 64 + 7) & ~(size_t) 7;
+        matrix = mem_straight(end);
+        bits = mem_straight(matrix + R);
+        memset(bits, 0, R * f * sizeof(uint64_t));
+    }
+    for (g = 0; g < R; ++g) {
+        matrix[g] = bits + g * f;
+        for (h = 0; h < mx.length[mx.live[g]]; ++h)
+            k = mx.column[mx.lists[mx.start[mx.live[g]] + h]], matrix[g][k >> 6] |= 1ULL << (k & 63);
+        matrix[g][(C + g) >> 6] |= 1ULL << ((C + g) & 63);
+    }
+    e = gf2_eliminate(matrix, R, C, f);
+    exponent = mem_straight(bits + R * f);
+    large = mem_straight(exponent + d);
+    if (stats) {
+        stats->rows = j, stats->core[0] = R, stats->core[1] = C;
+        stats->seconds[STAGE_MATRIX] += wall_time() - t, t = wall_time();
+        l = (size_t) ((char *) (large + 2 * rows[j]) - (char *) memory);
+        stats->memory = stats->memory > l ? stats->memory : l;
+    }
+    mont_init(&mont, number);
+    // the rows from e are null, each one is a product of relations whose |X^2 - N| multiply to a square Y^2.
+    for (a = 1; e < R && (a == 1 || a == number); ++e) {
+        memset(exponent, 0, d * sizeof(uint32_t));
+        memset(mx.stamp, 0, j * sizeof(uint32_t));
+        // the rows of the core sum rows of relations, those found an odd number of times are multiplied.
+        for (f = 0; f < R; ++f)
+            for (h = 0; matrix[e][(C + f) >> 6] >> ((C + f) & 63) & 1 && h < mx.origins[mx.live[f]]; ++h)
+                mx.stamp[mx.lists[mx.origin[mx.live[f]] + h]] ^= 1;
+        for (g = 0, k = 0, a = mont.one; g < j; ++g)
+            if (mx.stamp[g])
+                for (h = rows[g]; h < rows[g + 1]; ++h) {
+                    const smooth_number_t *rel = shared.relations + row_rels[h];
+                    a = mont_mul(&mont, a, mont_in(&mont, rel->X));
+                    for (l = 0; l < rel->count; ++exponent[shared.pool[rel->index + l++]]);
+                    for (l = 0; l < 2; ++l)
+                        if (rel->large[l] > 1) large[k++] = rel->large[l];
                 }
-            } while ((g ^= *mr_ptr != *(mr_ptr + 1)));
-    }
-    for (e = 0, f = 0; f < d; ++f)
-        for (g = e; g < j; ++g)
-            if (M_1[g * d + f]) {
-                if (g != e) {
-                    memcpy(T, M_1 + g * d, d);
-                    memcpy(M_1 + g * d, M_1 + e * d, d);
-                    memcpy(M_1 + e * d, T, d);
-                    memcpy(T, M_2 + g * d, d);
-                    memcpy(M_2 + g * d, M_2 + e * d, d);
-                    memcpy(M_2 + e * d, T, d);
+        // Y is the product of the halved exponents of the base, then of each large prime once per pair.
+        for (i = 1, c = mont.one; i < d; ++i)
+            if (exponent[i])
+                c = mont_mul(&mont, c, mont_pow(&mont, mont_in(&mont, base[i].p), exponent[i] >> 1));
+        qsort(large, k, sizeof(uint32_t), qs_compare);
+        for (l = 0; l + 1 < k; l += 2)
+            c = mont_mul(&mont, c, mont_in(&mont, large[l]));
+        a = mont_out(&mont, a), c = mont_out(&mont, c);
+        a = gcd_binary(a > c ? a - c : c - a, number);
+        if (stats) ++stats->dependencies;
+    }
+    if (stats) stats->seconds[STAGE_SQRT] += wall_time() - t;
+    return a ;
+}
+
+#define QS_TUNE 8        // semiprimes timed by qs_autotune for each row of the table.
+#define QS_BOUND_MIN 500 // qs_autotune doesn't lower the bound of the base below, smaller bases run short of coefficients A.
+
+// wall time of the sieve over count numbers with the current table.
+static double qs_time(const positive_number *numbers, const size_t count, void *memory) {
+    double t = wall_time();
+    for (size_t i = 0; i < count; quadratic_sieve(numbers[i++], memory, 0, 0));
+    return wall_time() - t;
+}
+
+// fit the table to the host : each row keeps in turn the block (half, once or twice the L1 data cache), the bound (2/3 or
+// 3/2 of its value, not below QS_BOUND_MIN) and the threshold (2 bits less or more) that sieve QS_TUNE semiprimes of its
+// size the fastest. memory is an arena of FACTOR_MEMORY bytes. the sieves read the table, so it is tuned before any of them runs.
+void qs_autotune(void *memory) {
+    const size_t rows = sizeof(qs_params) / sizeof(*qs_params);
+    positive_number numbers[QS_TUNE], p;
+    uint64_t rng = 0x5eed;
+    uint32_t block, bound, kept;
+    long cache = 0;
+    size_t i, j, r;
+    double best, t;
+    int bits, threshold, from;
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    cache = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+#endif
+    for (block = 1 << 13; cache > 0 && block < 1 << 17 && (long) block * 2 <= cache; block <<= 1);
+    for (r = 0; r < rows && qs_params[r].bits < 128; ++r) {
+        // balanced semiprimes of the size of the row, their factors have their two highest bits set.
+        for (i = 0; i < QS_TUNE; ++i)
+            for (j = 0, numbers[i] = 1; j < 2; numbers[i] *= p, ++j) {
+                bits = j ? qs_params[r].bits - qs_params[r].bits / 2 : qs_params[r].bits / 2;
+                p = ((positive_number) rng_next(&rng) << 64 | rng_next(&rng)) >> (128 - bits) | (positive_number) 3 << (bits - 2) | 1;
+                for (; !is_prime(p); p += 2);
+            }
+        best = qs_time(numbers, QS_TUNE, memory);
+        for (kept = qs_params[r].block, i = 0; cache > 0 && i < 3; ++i) {
+            qs_params[r].block = block << i >> 1;
+            if (qs_params[r].block != kept && (t = qs_time(numbers, QS_TUNE, memory)) < best) best = t, kept = qs_params[r].block;
+        }
+        qs_params[r].block = kept;
+        for (bound = kept = qs_params[r].bound, i = 0; i < 2; ++i) {
+            qs_params[r].bound = i ? bound / 2 * 3 : bound / 3 * 2;
+            if (qs_params[r].bound < QS_BOUND_MIN) continue;
+            if ((t = qs_time(numbers, QS_TUNE, memory)) < best) best = t, kept = qs_params[r].bound;
+        }
+        qs_params[r].bound = kept;
+        for (from = threshold = qs_params[r].threshold, i = 0; i < 2; ++i) {
+            qs_params[r].threshold = from + (i ? 2 : -2);
+            if ((t = qs_time(numbers, QS_TUNE, memory)) < best) best = t, threshold = qs_params[r].threshold;
+        }
+        qs_params[r].threshold = threshold;
+    }
+}
+
+#define FACTOR_MEMORY (1 << 25) // bytes of the scratch arena of a context.
+#define FACTOR_MAX 128          // room for the prime factors of a number, zero terminated.
+
+// reentrant state of the factorization, a thread factors with its own context.
+typedef struct {
+    uint64_t rng;              // generator of the rho start values.
+    void *memory;              // scratch arena of the quadratic sieve, FACTOR_MEMORY bytes.
+    const qs_config_t *config; // options of the quadratic sieve, may be null.
+    unsigned ecm_effort;       // percentage of the curves of the ECM schedule tried before the sieve, 0 skips ECM.
+    factor_stats_t *stats;     // accumulates the times and counters of the stages, may be null.
+} factor_context_t;
+
+// ECM bounds by size of the number, the curves cost about a quarter of the sieve they may save, b2 is 100 b1.
+static const struct {
+    int bits;
+    unsigned b1, curves;
+} ecm_schedule[] = {{64, 600, 4}, {90, 1000, 8}, {110, 2000, 16}};
+
+void factor_context_init(factor_context_t *ctx, void *memory, const qs_config_t *config, const uint64_t seed) {
+    ctx->rng = seed, ctx->memory = memory, ctx->config = config, ctx->ecm_effort = 100, ctx->stats = 0;
+}
+
+// primality test of the factorization, timed and counted in the stats of ctx.
+static int factor_is_prime(factor_context_t *ctx, const positive_number n) {
+    double t;
+    int p;
+    if (!ctx->stats) return is_prime(n);
+    t = wall_time(), p = is_prime(n);
+    ctx->stats->seconds[STAGE_PRIMALITY] += wall_time() - t, ++ctx->stats->primality;
+    return p;
+}
+
+#define FACTOR_CHEAP 0    // a short rho and ECM, the caller gets 1 or N back when they fail.
+#define FACTOR_FULL 1     // all the stages up to the sieve.
+#define FACTOR_DEFERRED 2 // the cheap stages already failed : the longer rho walks, then the sieve.
+
+static positive_number factor_stage(factor_context_t *ctx, const positive_number number, const int stage) {
+    factor_stats_t *stats = ctx->stats;
+    positive_number a, c;
+    size_t f, g;
+    double t;
+    if (number < 4)
+        return number; // number isn't factorisable.
+    if (!(number & 1))
+        return 2;
+    a = square_root(number);
+    if (a * a == number)
+        return a ; // number is a perfect square.
+    if ((a = perfect_power_root(number)) != 1)
+        return a ; // number is a perfect power, the sieve would find only trivial dependencies.
+    if (factor_is_prime(ctx, number))
+        return number; // number is prime.
+    t = stats ? wall_time() : 0;
+    if (!(number >> 64) && stage != FACTOR_DEFERRED) {
+        // single word path : small primes, rho then SQUFOF, the 128-bit stages follow when they fail.
+        if ((c = trial_division_64((uint64_t) number)) == 1)
+            c = rho_walk_64((uint64_t) number, (size_t) 1 << (bit_length(number) / 4 + RHO_64_SCALE), 1 + rng_next(&ctx->rng), stats ? &stats->rho : 0);
+        if (c == 1 || c == number)
+            c = squfof((uint64_t) number, stats ? &stats->squfof : 0);
+        if (stats) stats->seconds[STAGE_RHO] += wall_time() - t, t = wall_time();
+        if (c != 1 && c != number)
+            return c ; // number is factored in a single word.
+    }
+    for(f = stage == FACTOR_DEFERRED ? 15 : 10, c = 1; f <= (stage ? 18 : 14) && (c == number || c == 1); ++f)
+        c = rho_walk(number, (size_t) 1 << f, 1 + rng_next(&ctx->rng), stats ? &stats->rho : 0);
+    if (stats) stats->seconds[STAGE_RHO] += wall_time() - t;
+    if (c != number && c != 1)
+        return c ; // number is factored by rho.
+    for (g = sizeof(ecm_schedule) / sizeof(*ecm_schedule); g-- && bit_length(number) < ecm_schedule[g].bits;);
+    if (g != SIZE_MAX && ctx->ecm_effort && stage != FACTOR_DEFERRED) {
+        t = stats ? wall_time() : 0;
+        c = factor_ecm(number, ecm_schedule[g].b1, 100 * (size_t) ecm_schedule[g].b1,
+                       (ecm_schedule[g].curves * ctx->ecm_effort + 99) / 100, &ctx->rng, ctx->memory, stats ? &stats->curves : 0);
+        if (stats) stats->seconds[STAGE_ECM] += wall_time() - t;
+        if (c != number)
+            return c ; // number is factored by ECM.
+    }
+    return stage ? quadratic_sieve(number, ctx->memory, ctx->config, stats) : number;
+}
+
+positive_number factor_r(factor_context_t *ctx, const positive_number number) {
+    return factor_stage(ctx, number, FACTOR_FULL);
+}
+
+// factor with the options of the quadratic sieve, config may be null.
+positive_number factor_parallel(const positive_number number, void *memory, const qs_config_t *config) {
+    factor_context_t ctx;
+    factor_context_init(&ctx, memory, config, (uint64_t) (number ^ number >> 64));
+    return factor_r(&ctx, number);
+}
+
+positive_number factor(const positive_number number, void *memory) {
+    return factor_parallel(number, memory, 0);
+}
+
+// fill array with the prime factors of n and return its zero terminated end, in the FACTOR_CHEAP stage the composites left multiply *rest.
+static positive_number *factor_split(factor_context_t *ctx, positive_number n, positive_number *array, positive_number *rest, const int stage) {
+    positive_number a, b, r;
+    size_t s;
+    do  if (n < 4)
+            *array++ = n, n = 1;
+        else if (n & 1) {
+            if (b = square_root(n), b * b == n) {
+                r = 1;
+                s = (size_t) (factor_split(ctx, b, array, rest ? &r : 0, stage) - array);
+                memcpy(array + s, array, s * sizeof(positive_number));
+                array += s + s;
+                if (rest) *rest *= r * r;
+                n = 1;
+            } else if (factor_is_prime(ctx, n))
+                *array++ = n, n = 1;
+            else {
+                a = factor_stage(ctx, n, stage);
+                if (a != 1 && a != n) array = factor_split(ctx, a, array, rest, stage), n /= a; // success.
+                else if (rest) *rest *= n, n = 1;                                                // left to the sieve.
+                else *array++ = n, n = 1;                                                       // fail.
+            }
+        } else
+            for (; !(n & 1); *array++ = 2, n >>= 1);
+    while (n > 1);
+    *array = 0;
+    return array;
+}
+
+// sort the factors [array, end) by insertion, they are few.
+static void factor_sort(positive_number *array, const positive_number *end) {
+    positive_number c;
+    size_t g, h;
+    for (g = 1; array + g < end; ++g)
+        for (c = array[g], h = g; h && array[h - 1] > c; array[h] = array[h - 1], --h, array[h] = c);
+}
+
+// fill array with the sorted prime factors of n and return its zero terminated end.
+positive_number *factor_all(factor_context_t *ctx, const positive_number n, positive_number *array) {
+    positive_number *end = factor_split(ctx, n, array, 0, FACTOR_FULL);
+    factor_sort(array, end);
+    return end;
+}
+
+#ifndef BATCH_SMOOTH
+#define BATCH_SMOOTH 4096      // factor_batch strips the primes below this bound from all its numbers at once, 0 doesn't.
+#endif
+#define BATCH_SMOOTH_MIN 64    // smaller batches are left to the per number stages.
+#define MP_KARATSUBA 32        // products of at least this many limbs are split in halves.
+
+// multiprecision numbers of the batch smoothness test are little endian arrays of limbs, their lengths are held apart.
+static size_t mp_trim(const uint64_t *a, size_t n) {
+    for (; n && !a[n - 1]; --n);
+    return n;
+}
+
+// r = a + b with na >= nb, r may be a, returns the carry.
+static uint64_t mp_add(uint64_t *r, const uint64_t *a, const size_t na, const uint64_t *b, const size_t nb) {
+    uint64_t c = 0, s;
+    size_t i;
+    for (i = 0; i < nb; ++i) s = a[i] + c, c = s < c, r[i] = s + b[i], c += r[i] < s;
+    for (; i < na; ++i) r[i] = a[i] + c, c = r[i] < c;
+    return c;
+}
+
+// a -= b with na >= nb, returns the borrow.
+static uint64_t mp_sub(uint64_t *a, const size_t na, const uint64_t *b, const size_t nb) {
+    uint64_t c = 0, d, e;
+    size_t i;
+    for (i = 0; i < nb; ++i) d = a[i] - b[i], e = a[i] < b[i], a[i] = d - c, c = e | (d < c);
+    for (; i < na && c; ++i) c = a[i]-- == 0;
+    return c;
+}
+
+// r = a b of na + nb limbs, schoolbook.
+static void mp_mul_basic(uint64_t *r, const uint64_t *a, const size_t na, const uint64_t *b, const size_t nb) {
+    positive_number p;
+    uint64_t c;
+    size_t i, j;
+    memset(r, 0, na * sizeof(uint64_t));
+    for (i = 0; i < nb; r[i + na] = c, ++i)
+        for (c = 0, j = 0; j < na; ++j)
+            p = (positive_number) a[j] * b[i] + r[i + j] + c, r[i + j] = (uint64_t) p, c = (uint64_t) (p >> 64);
+}
+
+// r = a b of two operands of n limbs, Karatsuba : (a1 X + a0)(b1 X + b0) = z2 X^2 + ((a0 + a1)(b0 + b1) - z2 - z0) X + z0.
+// t holds about 4 n limbs of scratch.
+static void mp_karatsuba(uint64_t *r, const uint64_t *a, const uint64_t *b, const size_t n, uint64_t *t) {
+    const size_t h = (n + 1) / 2, l = n - h; // the low halves have h limbs, the high ones l.
+    uint64_t *s = t, *u = s + h + 1, *z = u + h + 1;
+    if (n < MP_KARATSUBA) {
+        mp_mul_basic(r, a, n, b, n);
+        return;
+    }
+    mp_karatsuba(r, a, b, h, t);
+    mp_karatsuba(r + 2 * h, a + h, b + h, l, t);
+    s[h] = mp_add(s, a, h, a + h, l), u[h] = mp_add(u, b, h, b + h, l);
+    mp_karatsuba(z, s, u, h + 1, z + 2 * h + 2);
+    mp_sub(z, 2 * h + 2, r, 2 * h), mp_sub(z, 2 * h + 2, r + 2 * h, 2 * l);
+    mp_add(r + h, r + h, h + 2 * l, z, 2 * h + 2);
+}
+
+// r = a b of na + nb limbs with na >= nb, a is cut in pieces of nb limbs. t holds 6 nb + 64 limbs.
+static void mp_mul(uint64_t *r, const uint64_t *a, const size_t na, const uint64_t *b, const size_t nb, uint64_t *t) {
+    size_t i, k;
+    if (nb < MP_KARATSUBA) {
+        mp_mul_basic(r, a, na, b, nb);
+        return;
+    }
+    memset(r, 0, (na + nb) * sizeof(uint64_t));
+    for (i = 0; i < na; i += nb) {
+        k = na - i < nb ? na - i : nb;
+        if (k == nb) mp_karatsuba(t, a + i, b, nb, t + 2 * nb);
+        else mp_mul_basic(t, b, nb, a + i, k);
+        mp_add(r + i, r + i, na + nb - i, t, nb + k);
+    }
+}
+
+// u mod v into the first nv limbs of u, Knuth's algorithm D, the top limb of v isn't null. t holds nu + nv + 1 limbs.
+static void mp_mod(uint64_t *u, const size_t nu, const uint64_t *v, const size_t nv, uint64_t *t) {
+    const int s = __builtin_clzll(v[nv - 1]);
+    uint64_t *vn = t, *un = t + nv, b, c, d, e, w;
+    positive_number p, q, r;
+    size_t i, j;
+    if (nu < nv) return;
+    if (nv == 1) {
+        for (c = 0, i = nu; i--; c = (uint64_t) (((positive_number) c << 64 | u[i]) % v[0]));
+        u[0] = c;
+        return;
+    }
+    // both operands are shifted so that the top bit of v is set, the quotient digits are then estimated within 2.
+    for (i = nv - 1; i; --i) vn[i] = v[i] << s | (s ? v[i - 1] >> (64 - s) : 0);
+    for (vn[0] = v[0] << s, un[nu] = s ? u[nu - 1] >> (64 - s) : 0, i = nu - 1; i; --i) un[i] = u[i] << s | (s ? u[i - 1] >> (64 - s) : 0);
+    for (un[0] = u[0] << s, j = nu - nv + 1; j--;) {
+        p = (positive_number) un[j + nv] << 64 | un[j + nv - 1];
+        for (q = p / vn[nv - 1], r = p % vn[nv - 1]; q >> 64 || q * vn[nv - 2] > (r << 64 | un[j + nv - 2]);)
+            if (--q, (r += vn[nv - 1]) >> 64) break;
+        for (b = 0, c = 0, i = 0; i < nv; ++i) {
+            p = q * vn[i] + c, c = (uint64_t) (p >> 64), w = (uint64_t) p;
+            d = un[i + j] - w, e = un[i + j] < w, un[i + j] = d - b, b = e | (d < b);
+        }
+        d = un[j + nv], un[j + nv] = d - c - b;
+        if ((positive_number) d < (positive_number) c + b) // the digit was one too large, v is added back.
+            un[j + nv] += mp_add(un + j, un + j, nv, vn, nv);
+    }
+    for (i = 0; i < nv; ++i) u[i] = un[i] >> s | (s ? un[i + 1] << (64 - s) : 0);
+}
+
+// products of the pairs of nodes of a level of a product tree, node k of n holds the limbs [off[k], off[k + 1]) of src.
+// returns the number of nodes of the next level, written the same way to dst and doff.
+static size_t mp_product_level(const uint64_t *src, const size_t *off, const size_t n, uint64_t *dst, size_t *doff, uint64_t *t) {
+    size_t k, na, nb;
+    for (doff[0] = 0, k = 0; k < n; k += 2) {
+        if (k + 1 == n) {
+            memcpy(dst + doff[k / 2], src + off[k], (off[k + 1] - off[k]) * sizeof(uint64_t));
+            doff[k / 2 + 1] = doff[k / 2] + off[k + 1] - off[k];
+            continue;
+        }
+        na = off[k + 1] - off[k], nb = off[k + 2] - off[k + 1];
+        if (na >= nb) mp_mul(dst + doff[k / 2], src + off[k], na, src + off[k + 1], nb, t);
+        else mp_mul(dst + doff[k / 2], src + off[k + 1], nb, src + off[k], na, t);
+        doff[k / 2 + 1] = doff[k / 2] + mp_trim(dst + doff[k / 2], na + nb);
+    }
+    return (n + 1) / 2;
+}
+
+// product of the odd primes below bound, its W limbs are malloced.
+static uint64_t *batch_primes(const uint32_t bound, size_t *W) {
+    const size_t half = bound / 2;
+    unsigned char *composite = calloc(half + 1, 1);
+    uint64_t *P = malloc((half + 2) * sizeof(uint64_t)), *Q = 0, *t = 0, *x, w;
+    size_t i, k, n = 0, *off = malloc((half + 2) * sizeof(size_t)), *doff = 0;
+    if (composite && P && off) {
+        // the leaves pack as many primes as a limb holds.
+        for (i = 1, w = 1; i < half; ++i)
+            if (!composite[i]) {
+                for (k = 2 * i * (i + 1); k < half; composite[k] = 1, k += 2 * i + 1);
+                if ((positive_number) w * (2 * i + 1) >> 64) P[n++] = w, w = 1;
+                w *= 2 * i + 1;
+            }
+        for (P[n++] = w, i = 0; i <= n; off[i] = i, ++i);
+        Q = malloc((n + 1) * sizeof(uint64_t)), doff = malloc((n + 2) * sizeof(size_t)), t = malloc((4 * n + 256) * sizeof(uint64_t));
+    }
+    if (Q && doff && t) {
+        for (; n > 1; x = P, P = Q, Q = x, memcpy(off, doff, (n + 1) * sizeof(size_t)))
+            n = mp_product_level(P, off, n, Q, doff, t);
+        *W = off[1];
+    } else free(P), P = 0;
+    free(composite), free(off), free(Q), free(doff), free(t);
+    return P;
+}
+
+// split a product of distinct primes below 2^32 into them, written from out, returns their end.
+static positive_number *batch_split(const positive_number g, positive_number *out, uint64_t *rng) {
+    positive_number d = 1;
+    if (g == 1) return out;
+    if (is_prime(g)) return *out = g, out + 1;
+    if (!(g >> 64)) d = trial_division_64((uint64_t) g);
+    while (d == 1 || d == g)
+        d = g >> 64 ? rho_walk(g, (size_t) 1 << 20, 1 + rng_next(rng), 0) : rho_walk_64((uint64_t) g, (size_t) 1 << 20, 1 + rng_next(rng), 0);
+    return batch_split(g / d, batch_split(d, out, rng), rng);
+}
+
+// strip the prime factors below bound from count numbers at once, after Bernstein : the remainder of the product P of the
+// primes modulo the product of all the numbers comes down their product tree, then gcd(P mod n, n) is the product of the
+// primes that divide n. the primes fill factors + i * FACTOR_MAX with repetition, sorted and zero terminated, rest[i] gets
+// the cofactor of numbers[i]. returns 0 when the memory is missing.
+int batch_smooth(const positive_number *numbers, positive_number *factors, positive_number *rest, const size_t count, const uint32_t bound) {
+    const size_t L = (size_t) bit_length(count) + 1, C = 2 * count; // levels of the tree of the numbers, limbs of a level.
+    positive_number *array, *end, g, c;
+    uint64_t rng = 0x5eed, *P, *Q = 0, *tree = 0, *rem = 0, *t = 0;
+    size_t h, i, k, n, nu, nv, levels, W = 0, *node = 0;
+    int res = 0;
+    for (i = 0; i < count; ++i) { // the factors 2 are shifted out.
+        array = factors + i * FACTOR_MAX, rest[i] = numbers[i];
+        for (; rest[i] && !(rest[i] & 1); *array++ = 2, rest[i] >>= 1);
+        *array = 0;
+    }
+    if (bound < 3 || count == 0) return 1;
+    if ((P = batch_primes(bound, &W))) {
+        Q = malloc((W + C) * sizeof(uint64_t)), t = malloc((W + 3 * C + 256) * sizeof(uint64_t));
+        tree = malloc(L * C * sizeof(uint64_t)), rem = malloc(L * C * sizeof(uint64_t)), node = malloc(L * (count + 1) * sizeof(size_t));
+    }
+    if (P && Q && t && tree && rem && node) {
+        // product tree of the odd parts, level h holds its nodes from node + h (count + 1) and its limbs from tree + h C.
+        for (node[0] = 0, i = 0; i < count; ++i) {
+            g = rest[i] ? rest[i] : 1, tree[node[i]] = (uint64_t) g, tree[node[i] + 1] = (uint64_t) (g >> 64);
+            node[i + 1] = node[i] + 1 + (g >> 64 != 0);
+        }
+        for (levels = 1, n = count; n > 1; ++levels)
+            n = mp_product_level(tree + (levels - 1) * C, node + (levels - 1) * (count + 1), n, tree + levels * C, node + levels * (count + 1), t);
+        // the remainders come down the tree, a remainder has the room of its node.
+        for (h = levels; h--;)
+            for (k = 0; k < (count + ((size_t) 1 << h) - 1) >> h; ++k) {
+                const size_t *o = node + h * (count + 1), *p = node + (h + 1) * (count + 1);
+                nv = o[k + 1] - o[k];
+                if (h + 1 == levels) memcpy(Q, P, (nu = W) * sizeof(uint64_t));
+                else nu = mp_trim(rem + (h + 1) * C + p[k / 2], p[k / 2 + 1] - p[k / 2]), memcpy(Q, rem + (h + 1) * C + p[k / 2], nu * sizeof(uint64_t));
+                mp_mod(Q, nu, tree + h * C + o[k], nv, t);
+                memset(rem + h * C + o[k], 0, nv * sizeof(uint64_t));
+                memcpy(rem + h * C + o[k], Q, (nu < nv ? nu : nv) * sizeof(uint64_t));
+            }
+        // the leaves hold P mod n, their gcd with n is the product of the primes to divide out.
+        for (i = 0; i < count; ++i) {
+            if (rest[i] < 3) continue;
+            g = rem[node[i]] | (node[i + 1] - node[i] > 1 ? (positive_number) rem[node[i] + 1] << 64 : 0);
+            for (array = factors + i * FACTOR_MAX; *array; ++array);
+            end = batch_split(gcd_binary(g, rest[i]), array, &rng);
+            for (k = (size_t) (end - array); k--;)
+                for (c = array[k], rest[i] /= c; rest[i] % c == 0; rest[i] /= c, *end++ = c);
+            factor_sort(array, end), *end = 0;
+        }
+        res = 1;
+    }
+    free(P), free(Q), free(t), free(tree), free(rem), free(node);
+    return res;
+}
+
+// a batch is split in one queue per thread, its numbers wait for the cheap stage then the composites left wait for the sieve.
+typedef struct {
+    size_t head, tail, *hard, hard_head, hard_tail; // numbers [head, tail), then hard[hard_head, hard_tail).
+#ifndef QS_NO_THREADS
+    pthread_mutex_t lock;
+#endif
+} batch_queue_t;
+
+// called with the index of a number when its factors are complete, one call at a time.
+typedef void factor_done_t(void *data, size_t i);
+
+typedef struct {
+    const positive_number *numbers;  // the cofactors left by batch_smooth, whose primes already are in factors.
+    positive_number *factors, *rest; // rest holds the composite part of each number left to the sieve.
+    size_t count, *hard;
+    size_t running, ready;           // numbers whose cheap stage isn't over, sieves queued and not taken.
+    batch_queue_t *queue;
+    unsigned threads;
+    factor_done_t *done;
+    void *data;
+#ifndef QS_NO_THREADS
+    pthread_mutex_t lock;            // held to update running and ready, and to call done.
+    pthread_cond_t more;             // signaled when a sieve is queued or when the last cheap stage is over.
+#endif
+} batch_t;
+
+typedef struct {
+    batch_t *batch;
+    factor_context_t ctx;
+    unsigned id;
+} batch_worker_t;
+
+// next job of a thread : all the cheap stages come before the sieves, the own queue is served from the front, the others are robbed from the back.
+// without a job, a thread waits while cheap stages are running elsewhere, they may still queue sieves.
+static size_t batch_next(batch_t *b, const unsigned id, int *hard) {
+    size_t i = SIZE_MAX;
+    unsigned t;
+    int over;
+    do {
+        for (*hard = 0; *hard < 2; ++*hard)
+            for (t = 0; t < b->threads; ++t) {
+                batch_queue_t *q = b->queue + (id + t) % b->threads;
+                QS_LOCK(q);
+                if (!*hard && q->head < q->tail) i = t ? --q->tail : q->head++;
+                else if (*hard && q->hard_head < q->hard_tail) i = q->hard[t ? --q->hard_tail : q->hard_head++];
+                QS_UNLOCK(q);
+                if (i != SIZE_MAX) {
+                    if (*hard) QS_LOCK(b), --b->ready, QS_UNLOCK(b);
+                    return i;
                 }
-                for (g = e + 1; g < j; ++g)
-                    if (M_1[g * d + f]) {
-                        char *lhs = M_1 + g * d, *rhs = M_1 + e * d;
-                        for (h = 0; h < d; lhs[h] = (char) (lhs[h] ^ rhs[h]), ++h);
-                        lhs = M_2 + g * d;
-                        rhs = M_2 + e * d;
-                        for (h = 0; h < d; lhs[h] = (char) (lhs[h] ^ rhs[h]), ++h);
-                    }
-                ++e;
-                break;
             }
-    for (e = j, f = 0; !memchr(M_1 + d * --e, 1, d); ++f);
-    cint_init(&v, number);
-    for (e = f, a = 1; e && (a == 1 || a == number); --e) {
-        cint_init(&r, a = 1);
-        for (f = 0, g = (j - e + 1) * d; f < d; ++f)
-            if (M_2[g + f]) {
-                a = multiplication_modulo(a, smooth_numbers[f].values[0], number);
-                cint_init(&s, smooth_numbers[f].values[1]);
-                cint_mul(&r, &s, &u);
-                r = u ;
+        QS_LOCK(b);
+#ifndef QS_NO_THREADS
+        while (!b->ready && b->running) pthread_cond_wait(&b->more, &b->lock);
+#endif
+        over = !b->ready && !b->running;
+        QS_UNLOCK(b);
+    } while (!over);
+    return i;
+}
+
+// account for the end of a job under the lock of the batch, the waiting threads learn of a queued sieve or of the last cheap stage.
+// a number queued for the sieve goes back to the queue owning it, it is counted as ready before any thread can take it.
+static void batch_end(batch_t *b, const size_t i, const int hard, const int queued) {
+    unsigned t;
+    QS_LOCK(b);
+    if (queued) {
+        for (t = (unsigned) (i * b->threads / b->count); t + 1 < b->threads && (size_t) (b->queue[t + 1].hard - b->hard) <= i; ++t);
+        QS_LOCK(b->queue + t);
+        b->queue[t].hard[b->queue[t].hard_tail++] = i;
+        QS_UNLOCK(b->queue + t);
+    }
+    b->running -= !hard, b->ready += queued;
+    if (!queued && b->done) b->done(b->data, i);
+#ifndef QS_NO_THREADS
+    if (queued || !b->running) pthread_cond_broadcast(&b->more);
+#endif
+    QS_UNLOCK(b);
+}
+
+static void *batch_worker(void *arg) {
+    batch_worker_t *w = arg;
+    batch_t *b = w->batch;
+    positive_number *array, *end;
+    size_t i;
+    int hard;
+    while ((i = batch_next(b, w->id, &hard)) != SIZE_MAX) {
+        array = b->factors + i * FACTOR_MAX;
+        if (hard) {
+            for (end = array; *end; ++end);
+            end = factor_split(&w->ctx, b->rest[i], end, 0, FACTOR_DEFERRED), b->rest[i] = 1;
+        } else {
+            for (end = array; *end; ++end);
+            b->rest[i] = 1;
+            if (b->numbers[i] > 1 || end == array) end = factor_split(&w->ctx, b->numbers[i], end, b->rest + i, FACTOR_CHEAP);
+            if (b->rest[i] > 1) { // the number waits for the sieve.
+                batch_end(b, i, hard, 1);
+                continue;
             }
-        cint_sqrt(&r, &t);
-        cint_div(&t, &v, &u, &r);
-        for (c = 0, f = 6; f > 2; c |= r.data[CINT_SCALE - --f], c <<= cint_exponent);
-        c |= r.data[CINT_SCALE - 1];
-        for (b = a > c ? a - c : c - a, a = number; b; c = b, b = a % b, a = c);
+        }
+        factor_sort(array, end);
+        batch_end(b, i, hard, 0);
     }
-    return a ;
+    return 0;
+}
+
+// factor count numbers with a pool of threads, the sorted prime factors of numbers[i] fill factors + i * FACTOR_MAX, zero terminated.
+// done may be null, else done(data, i) is called as soon as the factors of numbers[i] are complete. returns 0 when the memory is missing.
+int factor_batch_each(const positive_number *numbers, positive_number *factors, const size_t count, unsigned threads, factor_done_t *done, void *data) {
+    positive_number *cofactors;
+    batch_t b;
+    batch_worker_t *worker;
+    char *arena;
+    unsigned t;
+    if (count == 0) return 1;
+    threads = threads ? threads : 1;
+    threads = count < threads ? (unsigned) count : threads;
+#ifdef QS_NO_THREADS
+    threads = 1;
+#endif
+    for (; threads && !(arena = malloc((size_t) threads * (FACTOR_MEMORY + 512))); threads >>= 1);
+    if (threads == 0) return 0;
+    b.factors = factors, b.count = count, b.threads = threads, b.done = done, b.data = data;
+    b.running = count, b.ready = 0;
+    b.numbers = cofactors = malloc(count * sizeof(positive_number));
+    b.rest = malloc(count * sizeof(positive_number));
+    b.hard = malloc(count * sizeof(size_t));
+    b.queue = malloc(threads * sizeof(batch_queue_t));
+    worker = malloc(threads * sizeof(batch_worker_t));
+    if (cofactors && b.rest && b.hard && b.queue && worker && batch_smooth(numbers, factors, cofactors, count, count < BATCH_SMOOTH_MIN ? 2 : BATCH_SMOOTH)) {
+        for (t = 0; t < threads; ++t) {
+            b.queue[t].head = count * t / threads;
+            b.queue[t].tail = count * (t + 1) / threads;
+            b.queue[t].hard = b.hard + b.queue[t].head;
+            b.queue[t].hard_head = b.queue[t].hard_tail = 0;
+            worker[t].batch = &b, worker[t].id = t;
+            factor_context_init(&worker[t].ctx, mem_straight(arena + (size_t) t * (FACTOR_MEMORY + 512)), 0, 0x9E3779B97F4A7C15ULL * (t + 1));
+        }
+#ifndef QS_NO_THREADS
+        pthread_t *thread = malloc(threads * sizeof(pthread_t));
+        for (t = 0; t < threads; pthread_mutex_init(&b.queue[t++].lock, 0));
+        pthread_mutex_init(&b.lock, 0), pthread_cond_init(&b.more, 0);
+        for (t = 1; thread && t < threads && !pthread_create(thread + t, 0, batch_worker, worker + t); ++t);
+        batch_worker(worker);
+        while (--t) pthread_join(thread[t], 0);
+        for (t = 0; t < threads; pthread_mutex_destroy(&b.queue[t++].lock));
+        pthread_cond_destroy(&b.more), pthread_mutex_destroy(&b.lock);
+        free(thread);
+#else
+        batch_worker(worker);
+#endif
+    } else threads = 0;
+    free(worker), free(b.queue), free(b.hard), free(b.rest), free(cofactors), free(arena);
+    return threads != 0;
+}
+
+int factor_batch(const positive_number *numbers, positive_number *factors, const size_t count, unsigned threads) {
+    return factor_batch_each(numbers, factors, count, threads, 0, 0);
 }
 
 #endif